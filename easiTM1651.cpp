@@ -39,74 +39,140 @@
 
 #include "easiTM1651.h"
 
-// A table of 7-segment character codes (47 in total).
-uint8_t TM1651::tmCharTable[] = {0x3f, 0x06, 0x5b, 0x4f, 0x66, 0x6d, 0x7d, 0x07, 0x7f, 0x67, // Numbers : 0-9.
-                                 0x77, 0x7c, 0x39, 0x5e, 0x79, 0x71,                         // Numbers : A, b, C, d, E, F.
-                                 0x58, 0x6f, 0x74, 0x76, 0x10, 0x30, 0x1e, 0x38,             // Chars1  : c, g, h, H, i, I, J, L.
-                                 0x54, 0x37, 0x73, 0x50, 0x78, 0x1c, 0x3e, 0x6e,             // Chars2  : n, N, P, r, t, u, U, y.
-                                 0x00,                                                       // Blank   : Space = index 32. 
-                                 0x01, 0x40, 0x08, 0x63, 0x5c, 0x46, 0x70,                   // Specials: uDash, mDash, lDash, uBox, lBox, lBorder, rBorder.
-                                 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40};                  // Segments: SegA, SegB, SegC, SegD, SegE, SegF, SegG.
+// Count the bus statistics, or compile to nothing.
+#ifdef USEBUSSTATS51
+  #define STATS51(x)    x
+#else
+  #define STATS51(x)
+#endif
 
-// A table to describe the physical to logical digit numbering.
-#ifndef USEADDRAUTOMODE51
-  // This map assumes that the digits are logically addressed in the same order as they are physically built.
-  uint8_t TM1651::tmDigitMapDefault[] = {0, 1, 2, 3};
+// Record the pin trace, or compile to nothing.
+#ifdef USEPINTRACE51
+  #define TRACE51(x)    x
+#else
+  #define TRACE51(x)
 #endif
 
+// The pins in the pin trace, and the calls with latency histograms.
+#define TRACE_CLK51     0x01                              // The clock level.
+#define TRACE_DIO51     0x02                              // The data level.
+#define TRACE_OUT51     0x04                              // The data direction, set if it is an OUTPUT.
+#define TRACE_START51   0                                 // start().
+#define TRACE_BYTE51    1                                 // writeByte().
+#define TRACE_STOP51    2                                 // stop().
+
+// The steps of the asynchronous transmit state machine, each one is half a clock period or less on the bus.
+#define TX_IDLE51       0                                 // Waiting for a queued frame.
+#define TX_START51      1                                 // Start signal, data falling while the clock is high.
+#define TX_BITLOW51     2                                 // Clock low and the next data bit, LSB first.
+#define TX_BITHIGH51    3                                 // Clock high, the TM1651 reads the data bit.
+#define TX_ACKLOW51     4                                 // Clock low and release the data, the TM1651 pulls it low to ACK.
+#define TX_ACKHIGH51    5                                 // Clock high and data as input.
+#define TX_ACKREAD51    6                                 // Read the ACK.
+#define TX_ACKDONE51    7                                 // Data back to output, then the next byte or the stop signal.
+#define TX_STOPLOW51    8                                 // Clock and data low.
+#define TX_STOPHIGH51   9                                 // Clock high.
+#define TX_STOPEND51    10                                // Stop signal, data rising while the clock is high.
+
+// A table of 7-segment character codes (47 in total), built from their segments at compile time and kept in flash.
+const uint8_t TM1651::tmCharTable[] PROGMEM = {
+  tmSegments51("abcdef"), tmSegments51("bc"),     tmSegments51("abdeg"),  tmSegments51("abcdg"),    // Numbers : 0-3.
+  tmSegments51("bcfg"),   tmSegments51("acdfg"),  tmSegments51("acdefg"), tmSegments51("abc"),      // Numbers : 4-7.
+  tmSegments51("abcdefg"),tmSegments51("abcfg"),                                                    // Numbers : 8, 9.
+  tmSegments51("abcefg"), tmSegments51("cdefg"),  tmSegments51("adef"),   tmSegments51("bcdeg"),    // Numbers : A, b, C, d.
+  tmSegments51("adefg"),  tmSegments51("aefg"),                                                     // Numbers : E, F.
+  tmSegments51("deg"),    tmSegments51("abcdfg"), tmSegments51("cefg"),   tmSegments51("bcefg"),    // Chars1  : c, g, h, H.
+  tmSegments51("e"),      tmSegments51("ef"),     tmSegments51("bcde"),   tmSegments51("def"),      // Chars1  : i, I, J, L.
+  tmSegments51("ceg"),    tmSegments51("abcef"),  tmSegments51("abefg"),  tmSegments51("eg"),       // Chars2  : n, N, P, r.
+  tmSegments51("defg"),   tmSegments51("cde"),    tmSegments51("bcdef"),  tmSegments51("bcdfg"),    // Chars2  : t, u, U, y.
+  tmSegments51(""),                                                                                 // Blank   : Space = index 32.
+  tmSegments51("a"),      tmSegments51("g"),      tmSegments51("d"),      tmSegments51("abfg"),     // Specials: uDash, mDash, lDash, uBox.
+  tmSegments51("cdeg"),   tmSegments51("bcg"),    tmSegments51("efg"),                              // Specials: lBox, lBorder, rBorder.
+  tmSegments51("a"),      tmSegments51("b"),      tmSegments51("c"),      tmSegments51("d"),        // Segments: SegA, SegB, SegC, SegD.
+  tmSegments51("e"),      tmSegments51("f"),      tmSegments51("g")};                               // Segments: SegE, SegF, SegG.
+
+// The ASCII font, 0x20 - 0x7f, also kept in flash.
+const uint8_t TM1651::tmAsciiTable[] PROGMEM = {ASCIIFONT51};
+
+// The size of the character code table, defined here in case it is ever needed by reference.
+const uint8_t TM1651::charTableSize;
+
+// Check the tables are the size they are declared to be.
+static_assert(sizeof(TM1651::tmCharTable) == CHARTABLESIZE51, "The character code table size does not match CHARTABLESIZE51.");
+static_assert(sizeof(TM1651::tmAsciiTable) == 0x60, "The ASCII font must cover 0x20 - 0x7f.");
+
+// A table of the decimal digit powers of 10, used instead of division when displaying decimal numbers.
+static const uint16_t tmDecPowers[MAX_DIGITS51 - 1] PROGMEM = {1000, 100, 10};
+
+// A table to describe the physical to logical digit numbering.
+// This map assumes that the digits are logically addressed in the same order as they are physically built.
+uint8_t TM1651::tmDigitMapDefault[] = {0, 1, 2, 3};
+
 
 /**************************/
 /* Public Class Functions */
 /**************************/
 
 // Class constructor.
-TM1651::TM1651(uint8_t clkPin, uint8_t dataPin, bool LEDC68) {
+TM1651::TM1651(uint8_t clkPin, uint8_t dataPin, bool LEDC68, bool addrAuto) {
   _clkPin  = clkPin;                                      // Record the TM1651 clock pin.
   _dataPin = dataPin;                                     // Record the TM1651 data pin.
   _LEDC68 = LEDC68;                                       // Record if we have a Gotek LEDC68 module.
-  // Calculate the size of the character code table.
-  charTableSize = (sizeof(tmCharTable) / sizeof(*tmCharTable));
+  _addrAuto = addrAuto;                                   // Record the TM1651 addressing mode.
+  _tmDigitMap = tmDigitMapDefault;
+  #ifdef USENUMBERMEMO51
+    _memoDigits = 0x00;                                   // No numbers are remembered.
+  #endif
+  _txNack = false;                                        // Nothing has been sent yet.
+  _retries = DEF_RETRIES51;                               // Send a frame that was not acknowledged again, before rewriting the whole display.
+  _resyncDue = false;
+  _resyncing = false;
+  cmdDispCtrl = DISP_OFF51;                               // The TM1651 display is OFF at power up.
+  _transport = nullptr;                                   // The pins are bit banged.
+  _timing.clkHigh = DEF_CLKHIGH51;                        // Start with the default bus timing profile.
+  _timing.clkLow  = DEF_CLKLOW51;
+  _timing.setup   = DEF_SETUP51;
+  _timing.ackWait = DEF_ACKWAIT51;
+  #ifdef USEBUSSTATS51
+    _statsPins = 0x00;                                    // The pins start as inputs, reading LOW.
+  #endif
+  #ifdef USEPINTRACE51
+    _tracePins = 0x00;                                    // The pins start as inputs, reading LOW.
+    this->traceClear();
+  #endif
+  this->resetStats();
+  #ifdef USEASYNCMODE51
+    _txHead = _txTail = _txRetry = 0;                     // The transmit queue is empty...
+    _txState = TX_IDLE51;                                 // ... and nothing is being sent.
+    _txTries = 0;
+    _txLock = false;
+  #endif
+  #ifdef USEFASTPINIO51
+    // Resolve the pins to their port registers and bitmasks once, rather than on every pin access.
+    _clkOut   = portOutputRegister(digitalPinToPort(clkPin));
+    _clkMask  = digitalPinToBitMask(clkPin);
+    _dataOut  = portOutputRegister(digitalPinToPort(dataPin));
+    _dataMode = portModeRegister(digitalPinToPort(dataPin));
+    _dataIn   = portInputRegister(digitalPinToPort(dataPin));
+    _dataMask = digitalPinToBitMask(dataPin);
+  #endif
 }
 
 // Set up the display and initialise it with defaults values - with the default or no digit map.
 void TM1651::begin(uint8_t numDigits, uint8_t brightness) {
-  #ifndef USEADDRAUTOMODE51
-    _tmDigitMap = tmDigitMapDefault;
-  #endif
-  if(numDigits > 0 && numDigits <= MAX_DIGITS51) {        // The TM1651 module supports up to 4 digits.
-    _numDigits = numDigits;
-  }
-  else {
-    _numDigits = 1;
-  }
-  if(_numDigits != 3) {                                   // If we do not have 3 digits, we cannot have a Gotek LEDC68 module.
-    _LEDC68 = false;
-  }
-  pinMode(_clkPin, OUTPUT);                               // Set up the clock pin for output.
-  pinMode(_dataPin, OUTPUT);                              // Set up the data pin for output.
+  _tmDigitMap = tmDigitMapDefault;
+  this->setup(numDigits);                                 // Set up the digits and the pins.
   this->displayClear();                                   // Clear the display, all segments and decimal points.
   this->displayBrightness(brightness);                    // Set the display to the chosen (or default) brightness.
 }
 
-#ifndef USEADDRAUTOMODE51
-  // Set up the display and initialise it with defaults values - with a supplied digit map.
-  void TM1651::begin(uint8_t* tmDigitMap, uint8_t numDigits, uint8_t brightness) {
-    _tmDigitMap = tmDigitMap;
-    if(numDigits > 0 && numDigits <= MAX_DIGITS51) {      // The TM1651 module supports up to 4 digits.
-      _numDigits = numDigits;
-    }
-    else {
-      _numDigits = 1;
-    }
-    if(_numDigits != 3) {                                 // If we do not have 3 digits, we cannot have a Gotek LEDC68 module.
-      _LEDC68 = false;
-    }
-    pinMode(_clkPin, OUTPUT);                             // Set up the clock pin for output.
-    pinMode(_dataPin, OUTPUT);                            // Set up the data pin for output.
-    this->displayClear();                                 // Clear the display, all segments and decimal points.
-    this->displayBrightness(brightness);                  // Set the display to the chosen (or default) brightness.
-  }
-#endif
+// Set up the display and initialise it with defaults values - with a supplied digit map.
+void TM1651::begin(uint8_t* tmDigitMap, uint8_t numDigits, uint8_t brightness) {
+  _tmDigitMap = tmDigitMap;
+  this->setup(numDigits);                                 // Set up the digits and the pins.
+  this->displayClear();                                   // Clear the display, all segments and decimal points.
+  this->displayBrightness(brightness);                    // Set the display to the chosen (or default) brightness.
+}
 
 // Turn the TM1651 display OFF.
 void TM1651::displayOff(void) {
@@ -118,9 +184,12 @@ void TM1651::displayOff(void) {
 void TM1651::displayClear(void) {
   uint8_t digit;
   for(digit = 0; digit < _numDigits; digit++){
-    this->displayChar(digit, 0x00, true);                 // Write a zero (all segments OFF) to each digit.
+    this->setRegister(digit, 0x00);                       // Record a zero (all segments OFF) for each digit.
+  }
+  if(_LEDC68) {                                           // If we have a Gotek LEDC68 module with DP control.
+    this->setRegister(0x03, DP_OFF51);                    // Record the decimal points as OFF.
   }
-  this->displayDP(false);                                 // Turn OFF the decimal points.
+  this->writeChanged();                                   // Write the changed digits to the display.
 }
 
 // Set the brightness (0x00 - 0x07) and turn the TM1651 display ON.
@@ -132,36 +201,30 @@ void TM1651::displayBrightness(uint8_t brightness) {
 
 // Test the display - all the display digit segments (+dp if there is one).
 void TM1651::displayTest(bool dispTest) {
-  uint8_t digit;
-  // Work on the display digits.
-  this->writeCommand(ADDR_AUTO51);                        // Cmd to set auto incrementing address mode.
-  this->start();                                          // Send the start signal to the TM1651.
-  this->writeByte(STARTADDR51);                           // Set the address to the first digit.
+  uint8_t address, mask;
   if(dispTest) {
-    // Turn ON all digit segments.
-    for(digit = 0; digit < _numDigits; digit++) {
-      this->writeByte(0x7f);                              // Direct write to turn all digit segments ON.
+    // Turn ON all digit segments, and the decimal point if there is one, in a single burst.
+    this->writeAddrMode(ADDR_AUTO51);                     // Cmd to set auto incrementing address mode.
+    this->frameStart();                                   // Start the frame to the TM1651.
+    this->frameByte(STARTADDR51);                         // Set the address to the first digit.
+    for(address = 0, mask = this->digitMask(); mask != 0x00; address++, mask >>= 1) {
+      if(!(mask & 0x01)) {
+        this->frameByte(0x00);                            // An address with no digit mapped to it.
+      }
+      else if(_LEDC68 && address == 0x03) {               // If we have a Gotek LEDC68 module, the DP control follows the 3rd digit.
+        this->frameByte(DP_ON51);                         // Direct write to turn ON the decimal point.
+      }
+      else {
+        this->frameByte(0x7f);                            // Direct write to turn all digit segments ON.
+      }
     }
+    this->frameEnd();                                     // End the frame to the TM1651.
+    _dirty = this->digitMask();                           // The display no longer matches the recorded digit values.
   }
   else {
-    // Restore all the digit segments to their previous values.
-    for(digit = 0; digit < _numDigits; digit++) {
-      this->writeByte(_registers[digit]);                 // Restore the digit segments to what they were.
-    }
-  }
-  this->stop();                                           // Send the stop signal to the TM1651.
-  // Work on the decimal point if there is one.
-  if(_LEDC68) {                                           // If we have a Gotek LEDC68 module with DP control.
-    this->writeCommand(ADDR_FIXED51);                     // Cmd to set specific address mode.
-    this->start();                                        // Send the start signal to the TM1651.
-    this->writeByte(STARTADDR51 + 0x03);                  // Set the address to the decimal point control digiit.
-    if(dispTest) {
-      this->writeByte(DP_ON51);                           // Direct write to turn ON the decimal point.
-    }
-    else {
-      this->writeByte(_registers[0x03]);                  // Restore the decimal point to what it was.
-    }
-    this->stop();                                         // Send the stop signal to the TM1651.
+    // Restore all the digit segments (+dp) to their previous values.
+    _dirty = this->digitMask();
+    this->writeChanged();
   }
 }
 
@@ -175,201 +238,2005 @@ void TM1651::displayChar(uint8_t digit, uint8_t number, bool raw) {
       if(number >= charTableSize) {
         number = 0x20;                                    // This is a 0x00 (space) in the character table.
       }
-      number = tmCharTable[number];                       // Get the raw number from the character table.
+      number = charCode(number);                          // Get the raw number from the character table.
     }
-    _registers[digit] = number;                           // Record the latest value for this LED digit.
-    this->writeCommand(ADDR_FIXED51);                     // Cmd to set specific address mode.
-    this->writeDigit(digit);                              // Write the character digit to the display.
+    this->setRegister(digit, number);                     // Record the latest value for this LED digit.
+    this->writeChanged();                                 // Write the character digit to the display, if it has changed.
   }
 }
 
 // Display a decimal integer between 0 - 99, or a hex integer between 0x00 - 0xff, starting at a specific digit.
 void TM1651::displayInt8(uint8_t digit, uint8_t number, bool useDec) {
   if(_numDigits > 1 && digit < (_numDigits - 1)) {        // We need at least 2 digits to display an 8-bit number, leftmost digit is #0.
-    if(useDec) {
-      if(number > 99) {                                   // Clip the number at the maximum for a 2 digit decimal number.
-        number = 99;
-      }
-      _registers[digit]     = (tmCharTable[(number / 10) % 10]);
-      _registers[digit + 1] = (tmCharTable[ number       % 10]);
+    if(useDec && number > 99) {                           // Clip the number at the maximum for a 2 digit decimal number.
+      number = 99;
     }
-    else {
-      _registers[digit]     = (tmCharTable[(number / 16) % 16]);
-      _registers[digit + 1] = (tmCharTable[ number       % 16]);
-    }
-    #ifdef USEADDRAUTOMODE51
-      this->writeCommand(ADDR_AUTO51);                    // Cmd to set auto address mode.
-      this->writeDigit(digit, 2);                         // Write the digits of the 8-bit number.
-    #else
-      this->writeCommand(ADDR_FIXED51);                   // Cmd to set specific address mode.
-      this->writeDigit(digit);                            // Write the first digit of the 8-bit number.
-      this->writeDigit(digit + 1);                        // Write the second digit of the 8-bit number.
-    #endif
+    this->setNumber(digit, 2, number, useDec);            // Record the digits of the 8-bit number.
+    this->writeChanged();                                 // Write the changed digits of the 8-bit number.
   }
 }
 
 // Display a decimal integer between 0 - 999, or a hex integer between 0x000 - 0xfff, starting at a specific digit.
 void TM1651::displayInt12(uint8_t digit, uint16_t number, bool useDec) {
   if(_numDigits > 2 && digit < (_numDigits - 2)) {        // We need at least 3 digits to display an 12-bit number, leftmost digit is #0.
-    if(useDec) {
-      if(number > 999) {                                  // Clip the number at the maximum for a 3 digit decimal number.
-        number = 999;
-      }
-      _registers[digit]     = (tmCharTable[(number / 100) % 10]);
-      _registers[digit + 1] = (tmCharTable[(number /  10) % 10]);
-      _registers[digit + 2] = (tmCharTable[ number        % 10]);
+    if(useDec && number > 999) {                         // Clip the number at the maximum for a 3 digit decimal number.
+      number = 999;
     }
-    else {
-      if(number > 0xfff) {                                // Clip the number at the maximum for a 3 digit hexadecimal number.
-        number = 0xfff;
-      }
-      _registers[digit]     = (tmCharTable[(number / 256) % 16]);
-      _registers[digit + 1] = (tmCharTable[(number /  16) % 16]);
-      _registers[digit + 2] = (tmCharTable[ number        % 16]);
-    }
-    #ifdef USEADDRAUTOMODE51
-      this->writeCommand(ADDR_AUTO51);                    // Cmd to set auto address mode.
-      this->writeDigit(digit, 3);                         // Write the digits of the 12-bit number.
-    #else
-      this->writeCommand(ADDR_FIXED51);                   // Cmd to set specific address mode.
-      this->writeDigit(digit);                            // Write the first digit of the 12-bit number.
-      this->writeDigit(digit + 1);                        // Write the second digit of the 12-bit number.
-      this->writeDigit(digit + 2);                        // Write the third digit of the 12-bit number.
-    #endif
+    else if(!useDec && number > 0xfff) {                  // Clip the number at the maximum for a 3 digit hexadecimal number.
+      number = 0xfff;
+    }
+    this->setNumber(digit, 3, number, useDec);            // Record the digits of the 12-bit number.
+    this->writeChanged();                                 // Write the changed digits of the 12-bit number.
   }
 }
 
 // Display a decimal integer between 0 - 9999, or a hex integer between 0x0000 - 0xffff, starting at a specific digit.
 void TM1651::displayInt16(uint8_t digit, uint16_t number, bool useDec) {
   if(_numDigits > 3 && digit < (_numDigits - 3)) {        // We need at least 4 digits to display an 16-bit number, leftmost digit is #0.
-    if(useDec) {
-      if(number > 9999) {                                 // Clip the number at the maximum for a 4 digit decimal number.
-        number = 9999;
+    if(useDec && number > 9999) {                         // Clip the number at the maximum for a 4 digit decimal number.
+      number = 9999;
+    }
+    this->setNumber(digit, 4, number, useDec);            // Record the digits of the 16-bit number.
+    this->writeChanged();                                 // Write the changed digits of the 16-bit number.
+  }
+}
+
+// Display an ASCII string, starting at a specific digit - it stops at the end of the string or the last digit.
+void TM1651::displayString(uint8_t digit, const char* text) {
+  uint8_t character;
+  while(digit < _numDigits && (character = *text++) != 0x00) {
+    this->setRegister(digit++, (character >= 0x20 && character <= 0x7f) ? pgm_read_byte(&tmAsciiTable[character - 0x20]) : 0x00);
+  }
+  this->writeChanged();                                   // Write the changed digits of the string.
+}
+
+// Display an ASCII string from flash, e.g. F("Hi"), starting at a specific digit - it stops at the end of the string or the last digit.
+void TM1651::displayString(uint8_t digit, const __FlashStringHelper* text) {
+  const char* flashText = reinterpret_cast<const char*>(text);
+  uint8_t character;
+  while(digit < _numDigits && (character = pgm_read_byte(flashText++)) != 0x00) {
+    this->setRegister(digit++, (character >= 0x20 && character <= 0x7f) ? pgm_read_byte(&tmAsciiTable[character - 0x20]) : 0x00);
+  }
+  this->writeChanged();                                   // Write the changed digits of the string.
+}
+
+// Display a run of raw segment codes, e.g. encoded at compile time with tmAscii51(), starting at a specific digit.
+void TM1651::displayText(uint8_t digit, const uint8_t* codes, uint8_t numCodes) {
+  while(digit < _numDigits && numCodes-- > 0) {
+    this->setRegister(digit++, *codes++ & 0x7f);          // Ensure there are only 7 bits.
+  }
+  this->writeChanged();                                   // Write the changed digits of the text.
+}
+
+// Increment the decimal or hex number displayed in a run of digits, only changing the digits that roll over.
+void TM1651::displayIncrement(uint8_t digit, uint8_t numDigits, bool useDec) {
+  uint8_t base, value, lastDigit;
+  if(numDigits > 0 && digit < _numDigits && numDigits <= (_numDigits - digit)) {
+    base = useDec ? 10 : 16;
+    lastDigit = digit + numDigits - 1;
+    // Work left from the rightmost digit, only carrying into the next digit when this one rolls over.
+    do {
+      // Find the digit value from its character code - a blank, or any other character, counts as a 0.
+      for(value = 0; value < base && charCode(value) != _registers[lastDigit]; value++);
+      if(value >= base) {
+        value = 0;
+      }
+      if(++value < base) {
+        this->setRegister(lastDigit, charCode(value));
+        break;
       }
-      _registers[digit]     = (tmCharTable[(number / 1000) % 10]);
-      _registers[digit + 1] = (tmCharTable[(number /  100) % 10]);
-      _registers[digit + 2] = (tmCharTable[(number /   10) % 10]);
-      _registers[digit + 3] = (tmCharTable[ number         % 10]);
+      this->setRegister(lastDigit, charCode(0));         // This digit rolls over to 0, and carries into the next digit.
+    } while(lastDigit-- != digit);
+    this->writeChanged();                                 // Write the digits that rolled over, and the one that did not.
+  }
+}
+
+// Display a signed or fixed point number in a run of digits, with the leading zeros blanked (or not), right (or left) aligned.
+// With USENUMBERMEMO51, the last number shown in each run is remembered, so showing it again skips even the conversion.
+void TM1651::displayNumber(uint8_t digit, uint8_t numDigits, int16_t number, uint8_t decimals, uint8_t format) {
+  uint8_t config, power, value, first, length, width, position;
+  uint8_t values[MAX_DIGITS51];
+  uint16_t magnitude;
+  bool negative = false, overflow = false;
+  if(numDigits == 0 || digit >= _numDigits || numDigits > (_numDigits - digit)) {
+    return;
+  }
+  decimals &= NUM_DECIMALS51;
+  config = (format & (NUM_ZEROS51 | NUM_LEFT51 | NUM_HEX51)) | (decimals << 3) | numDigits;
+  #ifdef USENUMBERMEMO51
+    if(_memoConfig[digit] == config && _memoNumber[digit] == number) {
+      return;                                             // The same number, in the same format, is still on the display.
+    }
+    this->forgetNumbers(((1 << numDigits) - 1) << digit); // This number overwrites any remembered number it overlaps.
+  #endif
+  // Get the 4 digit values, most significant first.
+  if(config & NUM_HEX51) {
+    magnitude = (uint16_t)number;
+    for(power = 0; power < MAX_DIGITS51; power++) {
+      values[power] = (magnitude >> (12 - (power << 2))) & 0x0f;
+    }
+  }
+  else {
+    if(number < 0) {
+      negative = true;
+      magnitude = -(int32_t)number;
     }
     else {
-      _registers[digit]     = (tmCharTable[(number / 4096) % 16]);
-      _registers[digit + 1] = (tmCharTable[(number /  256) % 16]);
-      _registers[digit + 2] = (tmCharTable[(number /   16) % 16]);
-      _registers[digit + 3] = (tmCharTable[ number         % 16]);
-    }
-    #ifdef USEADDRAUTOMODE51
-      this->writeCommand(ADDR_AUTO51);                    // Cmd to set auto address mode.
-      this->writeDigit(digit, 4);                         // Write the digits of the 16-bit number.
-    #else
-      this->writeCommand(ADDR_FIXED51);                   // Cmd to set specific address mode.
-      this->writeDigit(digit);                            // Write the first digit of the 16-bit number.
-      this->writeDigit(digit + 1);                        // Write the second digit of the 16-bit number.
-      this->writeDigit(digit + 2);                        // Write the third digit of the 16-bit number.
-      this->writeDigit(digit + 3);                        // Write the fourth digit of the 16-bit number.
-    #endif
+      magnitude = number;
+    }
+    if(magnitude > 9999) {
+      overflow = true;                                    // Too big for 4 digits, so it will not fit any run of digits.
+      magnitude = 9999;
+    }
+    decDigits(magnitude, MAX_DIGITS51, values);
+  }
+  // Find the significant digits - at least the units, and a zero before the decimal point of a fixed point number.
+  for(first = 0; first < MAX_DIGITS51 - 1 && values[first] == 0; first++);
+  length = MAX_DIGITS51 - first;
+  if(length < decimals + 1) {
+    length = decimals + 1;
+  }
+  width = length + (negative ? 1 : 0);
+  if(overflow || width > numDigits) {
+    // The number does not fit, so fill the run of digits with the overflow indicator.
+    for(value = 0; value < numDigits; value++) {
+      this->setRegister(digit + value, charCode(negative ? 35 : 33)); // A lDash if it is too negative, or a uDash if it is too big.
+    }
+  }
+  else {
+    if(config & NUM_ZEROS51) {
+      length = numDigits - (negative ? 1 : 0);            // Keep the leading zeros, filling the whole run of digits.
+      width = numDigits;
+    }
+    // Blank the run of digits outside the number, then the sign (a mDash), then the digits.
+    position = (config & NUM_LEFT51) ? 0 : numDigits - width;
+    for(value = 0; value < numDigits; value++) {
+      if(value < position || value >= position + width) {
+        this->setRegister(digit + value, 0x00);
+      }
+    }
+    position += digit;
+    if(negative) {
+      this->setRegister(position++, charCode(34));        // A mDash.
+    }
+    for(power = MAX_DIGITS51 - length; power < MAX_DIGITS51; power++) {
+      this->setRegister(position++, charCode(values[power]));
+    }
   }
+  if(_LEDC68 && decimals > 0) {
+    // The LEDC68 has a single decimal point, turned ON for a fixed point number - the application lines it up with the decimals.
+    // A number with no decimals leaves it alone, so it does not undo displayDP(), or a fixed point number in another run of digits.
+    this->setRegister(0x03, DP_ON51);
+  }
+  #ifdef USENUMBERMEMO51
+    // Remember the number, after it has been recorded, so its own digits do not forget it.
+    _memoNumber[digit] = number;
+    _memoConfig[digit] = config;
+    _memoDigits |= this->memoMask(digit);
+  #endif
+  this->writeChanged();                                   // Write the changed digits of the number.
 }
 
 // Turn ON/OFF the decimal points.
 void TM1651::displayDP(bool status) {
-  uint8_t digit = 0x03;
   if(_LEDC68) {                                           // If we have a Gotek LEDC68 module with DP control.
-    _registers[digit] = status ? DP_ON51 : DP_OFF51;
-    this->writeCommand(ADDR_FIXED51);                     // Cmd to set specific address mode.
-    this->writeDigit(digit);                              // Write the character digit to the display.
+    this->setRegister(0x03, status ? DP_ON51 : DP_OFF51); // Record the decimal point state in the DP control digit.
+    this->writeChanged();                                 // Write the DP control digit to the display, if it has changed.
   }
 }
 
+// Get the recorded segment value of a digit (or the LEDC68 DP control at +0x03), as it is, or will be, in the TM1651 display RAM.
+uint8_t TM1651::readRegister(uint8_t digit) {
+  if(digit < MAX_DIGITS51) {
+    return(_registers[digit]);
+  }
+  return(0x00);
+}
 
-/***************************/
-/* Private Class Functions */
-/***************************/
+// Start a display update, holding back the digit writes until commit().
+void TM1651::beginUpdate(void) {
+  _updating = true;
+}
 
-// Write a command to the TM1651.
-void TM1651::writeCommand(uint8_t command) {
-  this->start();                                          // Send the start signal to the TM1651.
-  this->writeByte(command);                               // Write the command to the TM1651.
-  this->stop();                                           // Send the stop signal to the TM1651.
+// Finish a display update, writing only the changed digits to the TM1651.
+void TM1651::commit(void) {
+  _updating = false;
+  this->writeChanged();
 }
 
-#ifndef USEADDRAUTOMODE51
-  // Write the given logical digit value to the correct physical digit.
-  void TM1651::writeDigit(uint8_t digit) {
-    this->start();                                        // Send the start signal to the TM1651.
-    if(_LEDC68 && digit == 0x03) {
-      this->writeByte(STARTADDR51 + digit);               // Write the digit start address to the TM1651.
+#ifdef USEASYNCMODE51
+  // Send the next step of any queued frames - call from loop(), yield() or a timer interrupt, no more often than every 5us.
+  void TM1651::service(void) {
+    bool ack;
+    if(_txLock) {                                         // Already running, we must have interrupted ourselves.
+      return;
+    }
+    _txLock = true;
+    switch(_txState) {
+      case TX_IDLE51:
+        if(_txTail != _txHead) {                          // Is there a queued frame?
+          _txRetry = _txTail;                             // Keep the frame in the queue until it is acknowledged.
+          _txFrameNack = false;
+          _txBytes = _txQueue[_txTail];                   // Get the number of bytes in the frame.
+          _txTail = (_txTail + 1) & (TXQUEUE51 - 1);
+          TRACE51(_txTraceStart = TRACETIME51());
+          if(_transport != nullptr) {
+            _transport->start();                          // The transport sends the whole start signal...
+            TRACE51(this->traceCall(TRACE_START51, _txTraceStart));
+            this->txNextByte();                           // ... so get the first byte of the frame.
+          }
+          else {
+            this->clkWrite(HIGH);
+            this->dataWrite(HIGH);
+            _txState = TX_START51;
+          }
+        }
+        break;
+      case TX_START51:
+        this->dataWrite(LOW);
+        TRACE51(this->traceCall(TRACE_START51, _txTraceStart));
+        this->txNextByte();                               // Get the first byte of the frame.
+        break;
+      case TX_BITLOW51:
+        if(_transport != nullptr) {
+          _transport->writeByte(_txData);                 // The transport shifts out the whole byte while we wait for it.
+          _txState = TX_ACKREAD51;
+          break;
+        }
+        this->clkWrite(LOW);
+        this->dataWrite(_txData & 0x01);                  // LSB first.
+        _txData >>= 1;
+        _txState = TX_BITHIGH51;
+        break;
+      case TX_BITHIGH51:
+        this->clkWrite(HIGH);
+        _txState = (++_txBit < 8) ? TX_BITLOW51 : TX_ACKLOW51;
+        break;
+      case TX_ACKLOW51:
+        this->clkWrite(LOW);
+        this->dataWrite(HIGH);
+        _txState = TX_ACKHIGH51;
+        break;
+      case TX_ACKHIGH51:
+        this->clkWrite(HIGH);
+        this->dataMode(INPUT);
+        _txState = TX_ACKREAD51;
+        break;
+      case TX_ACKREAD51:
+        if(_transport != nullptr) {
+          if(_transport->busy()) {                        // The byte is still being shifted out, so try again next time.
+            break;
+          }
+          ack = _transport->ack();                        // The transport clocks the whole ACK.
+        }
+        else if((ack = (this->dataRead() == LOW))) {      // ACK = LOW if the transfer was successful.
+          this->dataMode(OUTPUT);
+          this->dataWrite(LOW);
+        }
+        if(!ack) {
+          _stats.nacks++;
+          _txFrameNack = true;
+        }
+        _txState = TX_ACKDONE51;
+        break;
+      case TX_ACKDONE51:
+        if(_transport == nullptr) {
+          this->dataMode(OUTPUT);
+        }
+        TRACE51(this->traceCall(TRACE_BYTE51, _txTraceStart));
+        if(--_txBytes) {
+          this->txNextByte();                             // Get the next byte of the frame.
+        }
+        else {
+          _txState = TX_STOPLOW51;                        // That was the last byte, so finish the frame.
+        }
+        break;
+      case TX_STOPLOW51:
+        TRACE51(_txTraceStart = TRACETIME51());
+        if(_transport != nullptr) {
+          _transport->stop();                             // The transport sends the whole stop signal.
+          this->txFrameDone();
+          break;
+        }
+        this->clkWrite(LOW);
+        this->dataWrite(LOW);
+        _txState = TX_STOPHIGH51;
+        break;
+      case TX_STOPHIGH51:
+        this->clkWrite(HIGH);
+        _txState = TX_STOPEND51;
+        break;
+      case TX_STOPEND51:
+        this->dataWrite(HIGH);
+        this->txFrameDone();
+        break;
+    }
+    _txLock = false;
+  }
+
+  // The frame has been sent - queue it again if it was not acknowledged, or free its space in the transmit queue.
+  void TM1651::txFrameDone(void) {
+    TRACE51(this->traceCall(TRACE_STOP51, _txTraceStart));
+    _stats.frames++;
+    if(_txFrameNack && _txTries < _retries) {
+      _txTries++;                                         // Send the frame again.
+      _stats.retries++;
+      _txTail = _txRetry;
     }
     else {
-      this->writeByte(STARTADDR51 + _tmDigitMap[digit]);  // Set the address for the requested digit.
+      if(_txFrameNack) {                                  // The retries failed, so the whole display must be rewritten.
+        _txNack = true;
+        _resyncDue = !_resyncing;
+      }
+      _txTries = 0;
+      _txRetry = _txTail;                                 // The frame is finished with, free its space in the queue.
     }
-    this->writeByte(_registers[digit]);                   // Write the number to the display digit.
-    this->stop();                                         // Send the stop signal to the TM1651.
+    _txState = TX_IDLE51;
+  }
+
+  // Get the next byte of the frame from the transmit queue, ready to send.
+  void TM1651::txNextByte(void) {
+    TRACE51(_txTraceStart = TRACETIME51());
+    _stats.bytes++;
+    _txData = _txQueue[_txTail];
+    _txTail = (_txTail + 1) & (TXQUEUE51 - 1);
+    _txBit = 0;
+    _txState = TX_BITLOW51;
+  }
+
+  // Check if there are queued frames still being sent.
+  bool TM1651::busy(void) {
+    return(_txState != TX_IDLE51 || _txTail != _txHead);
   }
 #else
-  // Write the given number of logical digit values to the correct physical digits.
-  void TM1651::writeDigit(uint8_t digit, uint8_t numDigits) {
-    uint8_t digitCounter;
-    this->start();                                        // Send the start signal to the TM1651.
-    this->writeByte(STARTADDR51 + digit);                 // Write the digit start address to the TM1651.
-    for(digitCounter = 0; digitCounter < numDigits; digitCounter++) {
-      this->writeByte(_registers[digit + digitCounter]);  // Write the current number to the display digit.
+  // Send the next step of any queued frames - frames are sent immediately, so there is nothing to do.
+  void TM1651::service(void) {
+  }
+
+  // Check if there are queued frames still being sent - frames are sent immediately, so never.
+  bool TM1651::busy(void) {
+    return(false);
+  }
+#endif
+
+// Get the bus statistics - the pin changes and delays are only counted when USEBUSSTATS51 is defined.
+TM1651Stats TM1651::getStats(void) {
+  return(_stats);
+}
+
+// Reset the bus statistics to zero.
+void TM1651::resetStats(void) {
+  _stats.frames  = 0;
+  _stats.bytes   = 0;
+  _stats.nacks   = 0;
+  _stats.retries = 0;
+  _stats.resyncs = 0;
+  #ifdef USEBUSSTATS51
+    _stats.edges  = 0;
+    _stats.delays = 0;
+  #endif
+}
+
+// Set the number of times a frame that was not acknowledged is sent again, before the whole display is rewritten.
+void TM1651::setRetries(uint8_t retries) {
+  _retries = retries;
+}
+
+// Set the transport that sends the frames, or nullptr to bit bang the pins - call before begin().
+void TM1651::setTransport(TM1651Transport* transport) {
+  this->flush();                                          // Nothing may be part way through being sent.
+  _transport = transport;
+  if(_transport != nullptr) {
+    _transport->begin();
+    _transport->setTiming(_timing);
+  }
+  else {
+    pinMode(_clkPin, OUTPUT);                             // Take the pins back from the transport.
+    pinMode(_dataPin, OUTPUT);
+  }
+}
+
+// Set the bus timing profile, in us - e.g. a profile found by calibrate() and pinned for production.
+void TM1651::setTiming(TM1651Timing timing) {
+  _timing = timing;
+  if(_transport != nullptr) {
+    _transport->setTiming(_timing);                       // A transport may bit bang some of the frame, e.g. the ACK.
+  }
+}
+
+// Get the bus timing profile, in us.
+TM1651Timing TM1651::getTiming(void) {
+  return(_timing);
+}
+
+// Find the fastest bus timing that the module acknowledges reliably, use it and return it - call after begin().
+// An ACK only proves that the TM1651 counted 8 clocks, so a margin is added to every timing, over the shortest that passed.
+TM1651Timing TM1651::calibrate(void) {
+  uint8_t retries = _retries;
+  _retries = 0;                                           // Hold off the retries and the display rewrites, so every failure is seen.
+  _resyncing = true;
+  if(this->calibrateTest()) {                             // Nothing to gain if the module does not ACK with the current timing.
+    // Shorten the ACK wait first, it is the longest, then the clock times.
+    this->calibrateStep(_timing.ackWait);
+    this->calibrateStep(_timing.clkHigh);
+    this->calibrateStep(_timing.setup);
+    this->calibrateStep(_timing.clkLow);
+  }
+  this->setTiming(_timing);                               // Hand the final profile to any transport.
+  // A failed test may have left the TM1651 in any address mode, with any digit values, so resend everything.
+  _retries = retries;
+  _resyncing = false;
+  this->resync();
+  this->flush();
+  return(_timing);
+}
+
+// Wait for all the queued frames to be sent, and check they were all acknowledged in the end, after any retries.
+bool TM1651::flush(void) {
+  bool ack, resynced = false;
+  while(this->busy()) {
+    this->service();
+    this->bitDelay();                                     // Give the TM1651 time for each step.
+    if(_resyncDue && !resynced) {                         // A frame failed, so rewrite the whole display - but only once, in case the bus is dead.
+      resynced = true;
+      _stats.resyncs++;
+      this->resync();
+    }
+  }
+  ack = !_txNack;
+  _txNack = false;
+  return(ack);
+}
+
+#ifdef USEPINTRACE51
+  // Write the pin trace as a VCD file, for PulseView or GTKWave - the times start at 0 with the oldest pin change in the trace.
+  void TM1651::traceVCD(Print& out) {
+    uint8_t index, pins, changed, pinBit;
+    uint32_t origin = 0, lastTime = 0;
+    static const char pinIds[] = "cdo";                   // The VCD identifiers of the clock, data and data direction.
+    out.print(F("$timescale " TRACESCALE51 " $end\n"));
+    out.print(F("$scope module tm1651 $end\n"));
+    out.print(F("$var wire 1 c CLK $end\n"));
+    out.print(F("$var wire 1 d DIO $end\n"));
+    out.print(F("$var wire 1 o DIO_OUTPUT $end\n"));
+    out.print(F("$upscope $end\n$enddefinitions $end\n"));
+    pins = 0x00;
+    for(index = 0; index < _traceCount; index++) {
+      const TraceEvent& event = _trace[(_traceHead + index) & (TRACEBUF51 - 1)];
+      if(index == 0) {
+        origin = event.time;
+        changed = TRACE_CLK51 | TRACE_DIO51 | TRACE_OUT51; // Dump every pin at the start.
+      }
+      else {
+        changed = event.pins ^ pins;
+      }
+      pins = event.pins;
+      if(index == 0 || event.time != lastTime) {          // Only a new time is written, the pin changes at the same time share it.
+        lastTime = event.time;
+        out.print('#');
+        out.print(event.time - origin);
+        out.print('\n');
+      }
+      for(pinBit = 0; pinBit < 3; pinBit++) {
+        if(changed & (1 << pinBit)) {
+          out.print((pins & (1 << pinBit)) ? '1' : '0');
+          out.print(pinIds[pinBit]);
+          out.print('\n');
+        }
+      }
+    }
+  }
+
+  // Write the latency histograms of the start, writeByte and stop calls - one line per call, with the count in each bin.
+  void TM1651::traceSummary(Print& out) {
+    uint8_t call, bin;
+    static const char* const callNames[] = {"start", "writeByte", "stop"};
+    for(call = 0; call < 3; call++) {
+      out.print(callNames[call]);
+      out.print(':');
+      for(bin = 0; bin < TRACEBINS51; bin++) {
+        out.print(' ');
+        out.print(bin == 0 ? 0UL : (1UL << bin));         // The lowest latency in the bin.
+        out.print(bin == (TRACEBINS51 - 1) ? F("us+=") : F("us="));
+        out.print(_traceHist[call][bin]);
+      }
+      out.print('\n');
+    }
+  }
+
+  // Clear the pin trace and the latency histograms - the current pin levels are kept for the next pin change.
+  void TM1651::traceClear(void) {
+    uint8_t call, bin;
+    _traceHead = 0;
+    _traceCount = 0;
+    for(call = 0; call < 3; call++) {
+      for(bin = 0; bin < TRACEBINS51; bin++) {
+        _traceHist[call][bin] = 0;
+      }
     }
-    this->stop();                                         // Send the stop signal to the TM1651.
   }
 #endif
 
-// Write a byte of data to the TM1651 - low level bit banging as per protocol.
-bool TM1651::writeByte(uint8_t data) {
-  bool ack;
-  uint8_t bit;
-  // Send 8 bits of data.
-  for(bit = 0; bit < 8; bit++) {
-    digitalWrite(_clkPin, LOW);
-    if(data & 0x01) {                                     // LSB first.
-      digitalWrite(_dataPin, HIGH);
+
+/***************************/
+/* Private Class Functions */
+/***************************/
+
+// Check that a burst of frames is acknowledged with the current bus timing - the display control command is harmless to repeat.
+bool TM1651::calibrateTest(void) {
+  uint8_t frame;
+  this->setTiming(_timing);                               // Any transport must test the same profile.
+  this->flush();                                          // Start with a clear ACK flag.
+  for(frame = 0; frame < CAL_FRAMES51; frame++) {
+    this->writeCommand(cmdDispCtrl);
+  }
+  return(this->flush());
+}
+
+// Reduce one bus timing while it passes, then add the margin - even a time that passed all the way down to 0 gets it,
+// as a burst of ACKs is no proof of the worst case.
+void TM1651::calibrateStep(uint8_t& time) {
+  while(time > 0) {
+    time--;
+    if(!this->calibrateTest()) {
+      time++;                                             // Back to the last pass.
+      break;
     }
-    else {
-      digitalWrite(_dataPin, LOW);
+  }
+  time += CAL_MARGIN51;
+}
+
+// Set up the digits and the pins, ready for the display to be initialised.
+void TM1651::setup(uint8_t numDigits) {
+  uint8_t digit;
+  if(numDigits > 0 && numDigits <= MAX_DIGITS51) {        // The TM1651 module supports up to 4 digits.
+    _numDigits = numDigits;
+  }
+  else {
+    _numDigits = 1;
+  }
+  if(_numDigits != 3) {                                   // If we do not have 3 digits, we cannot have a Gotek LEDC68 module.
+    _LEDC68 = false;
+  }
+  pinMode(_clkPin, OUTPUT);                               // Set up the clock pin for output.
+  pinMode(_dataPin, OUTPUT);                              // Set up the data pin for output.
+  _updating = false;                                      // Digit writes go straight to the TM1651.
+  _cmdAddrMode = 0x00;                                    // The TM1651 address mode is not yet known.
+  #ifdef USENUMBERMEMO51
+    this->forgetNumbers(0xff);                            // No numbers are remembered.
+  #endif
+  // Build the transmit image from the digit values, in the physical order of the digit map.
+  for(digit = 0; digit < MAX_DIGITS51; digit++) {
+    _image[digit] = 0x00;
+  }
+  for(digit = 0; digit < MAX_DIGITS51; digit++) {
+    if(digit < _numDigits || (_LEDC68 && digit == 0x03)) {
+      _image[this->physDigit(digit)] = _registers[digit];
     }
-    data >>= 1;
-    digitalWrite(_clkPin, HIGH);
   }
-  // Wait for the ACK.
-  digitalWrite(_clkPin, LOW);
-  digitalWrite(_dataPin, HIGH);
-  digitalWrite(_clkPin, HIGH);
-  pinMode(_dataPin, INPUT);
-  this->bitDelay(); 
-  ack = digitalRead(_dataPin);
-  if(ack == LOW) {                                        // ACK = LOW if the transfer was successful.
-    pinMode(_dataPin, OUTPUT);
-    digitalWrite(_dataPin, LOW);
+  _dirty = this->digitMask();                             // Every digit must be written at least once.
+}
+
+// Record the digits of a decimal or hex number, the number must fit in the given number of digits.
+void TM1651::setNumber(uint8_t digit, uint8_t numDigits, uint16_t number, bool useDec) {
+  uint8_t power;
+  uint8_t values[MAX_DIGITS51];
+  if(useDec) {
+    decDigits(number, numDigits, values);
+    for(power = 0; power < numDigits; power++) {
+      this->setRegister(digit + power, charCode(values[power]));
+    }
+  }
+  else {
+    // Each hex digit is simply the next 4 bits, working from the rightmost digit.
+    for(digit += numDigits; numDigits > 0; numDigits--) {
+      this->setRegister(--digit, charCode(number & 0x0f));
+      number >>= 4;
+    }
   }
-  this->bitDelay();
-  pinMode(_dataPin, OUTPUT);
-  this->bitDelay();
-  return(ack);                                            // Is this even useful?
 }
 
-// Send a start signal to the TM1651 - low level bit banging as per protocol.
-void TM1651::start(void) {
-  digitalWrite(_clkPin, HIGH);
-  digitalWrite(_dataPin, HIGH);
-  digitalWrite(_dataPin, LOW);
-  digitalWrite(_clkPin, LOW);
+// Split a decimal number into its digit values, most significant first, the number must fit in the given number of digits.
+void TM1651::decDigits(uint16_t number, uint8_t numDigits, uint8_t* values) {
+  uint8_t power, value;
+  uint16_t tenPower;
+  // Count each decimal digit by repeated subtraction, as there is no hardware divider on the AVR.
+  for(power = MAX_DIGITS51 - numDigits; power < MAX_DIGITS51 - 1; power++) {
+    tenPower = pgm_read_word(&tmDecPowers[power]);
+    for(value = 0; number >= tenPower; value++) {
+      number -= tenPower;
+    }
+    *values++ = value;
+  }
+  *values = number;                                       // Whatever is left is the units.
 }
 
-//Send a stop signal to the TM1651 - low level bit banging as per protocol.
-void TM1651::stop(void) {
-  digitalWrite(_clkPin, LOW);
-  digitalWrite(_dataPin, LOW);
-  digitalWrite(_clkPin, HIGH);
-  digitalWrite(_dataPin, HIGH);
+#ifdef USENUMBERMEMO51
+  // Get a bitmap of the digits (+dp) covered by the number remembered for a starting digit.
+  uint8_t TM1651::memoMask(uint8_t digit) {
+    uint8_t config = _memoConfig[digit];
+    uint8_t mask = ((1 << (config & 0x07)) - 1) << digit;
+    if(_LEDC68 && (config & (NUM_DECIMALS51 << 3))) {     // A fixed point number also sets the LEDC68 DP control.
+      mask |= (1 << 0x03);
+    }
+    return(mask);
+  }
+
+  // Forget the remembered numbers covering any of the given digits (+dp).
+  void TM1651::forgetNumbers(uint8_t mask) {
+    uint8_t digit;
+    _memoDigits = 0x00;
+    for(digit = 0; digit < MAX_DIGITS51; digit++) {
+      if(_memoConfig[digit] != 0) {
+        if(this->memoMask(digit) & mask) {
+          _memoConfig[digit] = 0;
+        }
+        else {
+          _memoDigits |= this->memoMask(digit);
+        }
+      }
+    }
+  }
+#endif
+
+// Get a code from the character code table in flash.
+uint8_t TM1651::charCode(uint8_t index) {
+  return(pgm_read_byte(&tmCharTable[index]));
 }
 
-// Wait for a bit...
-void TM1651::bitDelay(void) {
-  delayMicroseconds(5);                                   // I think this might go as low as 4us (250KHz).
+// Get a bitmap of the physical addresses of all the digits in use (+dp if there is one).
+uint8_t TM1651::digitMask(void) {
+  uint8_t digit, mask = 0x00;
+  for(digit = 0; digit < _numDigits; digit++) {
+    mask |= (1 << this->physDigit(digit));
+  }
+  if(_LEDC68) {                                           // If we have a Gotek LEDC68 module, the DP control is at address +0x03.
+    mask |= (1 << 0x03);
+  }
+  return(mask);
+}
+
+// Get the physical address of a logical digit - the LEDC68 DP control is not mapped.
+uint8_t TM1651::physDigit(uint8_t digit) {
+  if(_LEDC68 && digit == 0x03) {
+    return(digit);
+  }
+  return(_tmDigitMap[digit] & (MAX_DIGITS51 - 1));
+}
+
+// Record a new value for a digit, copying it to its physical place in the transmit image and marking it as changed if it is different.
+void TM1651::setRegister(uint8_t digit, uint8_t value) {
+  uint8_t address;
+  if(_registers[digit] != value) {
+    #ifdef USENUMBERMEMO51
+      if(_memoDigits & (1 << digit)) {                    // Any remembered number covering this digit is no longer on the display.
+        this->forgetNumbers(1 << digit);
+      }
+    #endif
+    _registers[digit] = value;
+    address = this->physDigit(digit);
+    _image[address] = value;
+    _dirty |= (1 << address);
+  }
+}
+
+// Write all the changed digits to the TM1651, unless they are being held back until commit().
+void TM1651::writeChanged(void) {
+  uint8_t digit;
+  if(_updating || _dirty == 0) {
+    return;
+  }
+  if(_addrAuto) {
+    uint8_t lastDigit;
+    // Write everything from the first to the last changed address in one burst - an unchanged digit in between costs less than another frame.
+    for(digit = 0; !(_dirty & (1 << digit)); digit++);
+    for(lastDigit = MAX_DIGITS51 - 1; !(_dirty & (1 << lastDigit)); lastDigit--);
+    this->writeAddrMode(ADDR_AUTO51);                     // Cmd to set auto address mode.
+    this->writeDigits(digit, lastDigit - digit + 1);      // Write the changed addresses.
+  }
+  else {
+    this->writeAddrMode(ADDR_FIXED51);                    // Cmd to set specific address mode.
+    for(digit = 0; digit < MAX_DIGITS51; digit++) {
+      if(_dirty & (1 << digit)) {
+        this->writeDigit(digit);                          // Write each changed address.
+      }
+    }
+  }
+  _dirty = 0;
+}
+
+// Write an address mode command to the TM1651, if it is not already set.
+void TM1651::writeAddrMode(uint8_t command) {
+  if(command != _cmdAddrMode) {
+    _cmdAddrMode = command;
+    this->writeCommand(command);
+  }
+}
+
+// Write a command to the TM1651.
+void TM1651::writeCommand(uint8_t command) {
+  this->frameStart();                                     // Start the frame to the TM1651.
+  this->frameByte(command);                               // Write the command to the TM1651.
+  this->frameEnd();                                       // End the frame to the TM1651.
+}
+
+// Rewrite the display control, address mode and every digit to the TM1651 - the digits go in one burst in auto address mode.
+void TM1651::resync(void) {
+  _resyncing = true;                                      // A failure while rewriting must not start another rewrite.
+  _resyncDue = false;
+  _cmdAddrMode = 0x00;                                    // The TM1651 address mode is no longer known.
+  _dirty = this->digitMask();                             // The TM1651 display RAM is no longer known.
+  this->writeCommand(cmdDispCtrl);
+  this->writeChanged();
+  _resyncing = false;
+}
+
+// Write the transmit image value of the given physical address, in fixed address mode.
+void TM1651::writeDigit(uint8_t address) {
+  this->frameStart();                                     // Start the frame to the TM1651.
+  this->frameByte(STARTADDR51 + address);                 // Set the address for the requested digit.
+  this->frameByte(_image[address]);                       // Write the number to the display digit.
+  this->frameEnd();                                       // End the frame to the TM1651.
+}
+
+// Write the transmit image values of the given number of physical addresses in one burst, in auto address mode.
+void TM1651::writeDigits(uint8_t address, uint8_t numDigits) {
+  uint8_t digitCounter;
+  this->frameStart();                                     // Start the frame to the TM1651.
+  this->frameByte(STARTADDR51 + address);                 // Write the digit start address to the TM1651.
+  for(digitCounter = 0; digitCounter < numDigits; digitCounter++) {
+    this->frameByte(_image[address + digitCounter]);      // Write the current number to the display digit.
+  }
+  this->frameEnd();                                       // End the frame to the TM1651.
+}
+
+#ifdef USEASYNCMODE51
+  // Start a frame to the TM1651 - reserve the byte count in the transmit queue, waiting for space if necessary.
+  void TM1651::frameStart(void) {
+    if(_resyncDue && !_resyncing) {                       // A frame failed, so rewrite the whole display before anything else.
+      _stats.resyncs++;
+      this->resync();
+    }
+    while(((_txRetry - _txHead - 1) & (TXQUEUE51 - 1)) < (MAXFRAME51 + 1)) {
+      this->service();                                    // The queue is full, so send some of it now.
+      this->bitDelay();                                   // Give the TM1651 time for each step.
+    }
+    _txFrame = _txHead;
+    _txNext = (_txHead + 1) & (TXQUEUE51 - 1);
+  }
+
+  // Add a byte of data to the frame in the transmit queue.
+  void TM1651::frameByte(uint8_t data) {
+    _txQueue[_txNext] = data;
+    _txNext = (_txNext + 1) & (TXQUEUE51 - 1);
+  }
+
+  // End the frame - record its byte count and make it available to service().
+  void TM1651::frameEnd(void) {
+    _txQueue[_txFrame] = (_txNext - _txFrame - 1) & (TXQUEUE51 - 1);
+    _txHead = _txNext;
+  }
+#else
+  // Start a frame to the TM1651 - after rewriting the whole display, if the last rewrite failed too.
+  void TM1651::frameStart(void) {
+    if(_resyncDue && !_resyncing) {                       // The bus failed even while rewriting, so try again before anything else.
+      _stats.resyncs++;
+      this->resync();
+    }
+    _frameLen = 0;
+    _frameNack = false;
+    this->start();                                        // Send the start signal to the TM1651.
+  }
+
+  // Write a byte of data in the frame to the TM1651, keeping a copy in case the frame has to be sent again.
+  void TM1651::frameByte(uint8_t data) {
+    if(_frameLen < MAXFRAME51) {
+      _frame[_frameLen++] = data;
+    }
+    if(this->writeByte(data) != LOW) {                    // ACK = LOW if the transfer was successful.
+      _frameNack = true;
+    }
+  }
+
+  // End the frame to the TM1651 - send it again if it was not acknowledged, then rewrite the whole display if that failed too.
+  // A rewrite that fails is left due, so the next frame starts with another rewrite.
+  void TM1651::frameEnd(void) {
+    uint8_t tries, index;
+    this->stop();                                         // Send the stop signal to the TM1651.
+    for(tries = 0; _frameNack && tries < _retries; tries++) {
+      _stats.retries++;
+      _frameNack = false;
+      this->start();
+      for(index = 0; index < _frameLen; index++) {
+        if(this->writeByte(_frame[index]) != LOW) {
+          _frameNack = true;
+        }
+      }
+      this->stop();
+    }
+    if(_frameNack) {
+      _txNack = true;
+      _resyncDue = true;                                  // Cleared by resync(), and set again if the rewrite fails.
+      if(!_resyncing) {
+        _stats.resyncs++;
+        this->resync();
+      }
+    }
+  }
+#endif
+
+// Write a byte of data to the TM1651 - low level bit banging as per protocol, unless there is a transport.
+bool TM1651::writeByte(uint8_t data) {
+  bool ack;
+  uint8_t bit;
+  TRACE51(uint32_t traceStart = TRACETIME51());
+  _stats.bytes++;
+  if(_transport != nullptr) {
+    _transport->writeByte(data);
+    while(_transport->busy());                            // Wait for the byte to be shifted out.
+    ack = _transport->ack() ? LOW : HIGH;                 // ACK = LOW if the transfer was successful.
+    if(ack != LOW) {
+      _stats.nacks++;
+    }
+    TRACE51(this->traceCall(TRACE_BYTE51, traceStart));
+    return(ack);
+  }
+  // Send 8 bits of data.
+  for(bit = 0; bit < 8; bit++) {
+    this->clkWrite(LOW);
+    this->pinDelay(_timing.clkLow);
+    this->dataWrite(data & 0x01);                         // LSB first.
+    data >>= 1;
+    this->pinDelay(_timing.setup);
+    this->clkWrite(HIGH);
+    this->pinDelay(_timing.clkHigh);
+  }
+  // Wait for the ACK.
+  this->clkWrite(LOW);
+  this->dataWrite(HIGH);
+  this->clkWrite(HIGH);
+  this->dataMode(INPUT);
+  this->bitDelay(); 
+  ack = this->dataRead();
+  if(ack == LOW) {                                        // ACK = LOW if the transfer was successful.
+    this->dataMode(OUTPUT);
+    this->dataWrite(LOW);
+  }
+  else {
+    _stats.nacks++;
+  }
+  this->bitDelay();
+  this->dataMode(OUTPUT);
+  this->bitDelay();
+  TRACE51(this->traceCall(TRACE_BYTE51, traceStart));
+  return(ack);
+}
+
+// Send a start signal to the TM1651 - low level bit banging as per protocol, unless there is a transport.
+void TM1651::start(void) {
+  TRACE51(uint32_t traceStart = TRACETIME51());
+  if(_transport != nullptr) {
+    _transport->start();
+  }
+  else {
+    this->clkWrite(HIGH);
+    this->dataWrite(HIGH);
+    this->pinDelay(_timing.setup);
+    this->dataWrite(LOW);
+    this->pinDelay(_timing.clkHigh);
+    this->clkWrite(LOW);
+  }
+  TRACE51(this->traceCall(TRACE_START51, traceStart));
+}
+
+//Send a stop signal to the TM1651 - low level bit banging as per protocol, unless there is a transport.
+void TM1651::stop(void) {
+  TRACE51(uint32_t traceStart = TRACETIME51());
+  _stats.frames++;
+  if(_transport != nullptr) {
+    _transport->stop();
+  }
+  else {
+    this->clkWrite(LOW);
+    this->dataWrite(LOW);
+    this->pinDelay(_timing.setup);
+    this->clkWrite(HIGH);
+    this->pinDelay(_timing.clkHigh);
+    this->dataWrite(HIGH);
+  }
+  TRACE51(this->traceCall(TRACE_STOP51, traceStart));
+}
+
+// Wait for a bit...
+void TM1651::bitDelay(void) {
+  STATS51(_stats.delays++);
+  this->pinDelay(_timing.ackWait);                        // 5us by default, calibrate() finds how low the module can go.
+}
+
+// Wait for one of the bus timing profile times in us - a zero time has no delay at all.
+void TM1651::pinDelay(uint8_t time) {
+  if(time > 0) {
+    delayMicroseconds(time);
+  }
+}
+
+#ifdef USEFASTPINIO51
+  // Set the clock pin HIGH or LOW - direct port register write, atomic with respect to interrupts.
+  void TM1651::clkWrite(uint8_t level) {
+    STATS51(this->statsEdge(0x01, level));
+    TRACE51(this->traceEdge(TRACE_CLK51, level));
+    uint8_t oldSREG = SREG;
+    cli();
+    if(level == LOW) {
+      *_clkOut &= ~_clkMask;
+    }
+    else {
+      *_clkOut |= _clkMask;
+    }
+    SREG = oldSREG;
+  }
+
+  // Set the data pin HIGH or LOW - direct port register write, atomic with respect to interrupts.
+  void TM1651::dataWrite(uint8_t level) {
+    STATS51(this->statsEdge(0x02, level));
+    TRACE51(this->traceEdge(TRACE_DIO51, level));
+    uint8_t oldSREG = SREG;
+    cli();
+    if(level == LOW) {
+      *_dataOut &= ~_dataMask;
+    }
+    else {
+      *_dataOut |= _dataMask;
+    }
+    SREG = oldSREG;
+  }
+
+  // Set the data pin to INPUT or OUTPUT - as pinMode(), an INPUT also has its pullup turned OFF.
+  void TM1651::dataMode(uint8_t mode) {
+    TRACE51(this->traceEdge(TRACE_OUT51, mode == OUTPUT));
+    uint8_t oldSREG = SREG;
+    cli();
+    if(mode == INPUT) {
+      *_dataMode &= ~_dataMask;
+      *_dataOut  &= ~_dataMask;
+    }
+    else {
+      *_dataMode |= _dataMask;
+    }
+    SREG = oldSREG;
+  }
+
+  // Read the data pin - direct port register read.
+  uint8_t TM1651::dataRead(void) {
+    uint8_t level = (*_dataIn & _dataMask) ? HIGH : LOW;
+    TRACE51(this->traceEdge(TRACE_DIO51, level));         // The level driven by the TM1651, e.g. the ACK.
+    return(level);
+  }
+#else
+  // Set the clock pin HIGH or LOW - portable fallback.
+  void TM1651::clkWrite(uint8_t level) {
+    STATS51(this->statsEdge(0x01, level));
+    TRACE51(this->traceEdge(TRACE_CLK51, level));
+    digitalWrite(_clkPin, level);
+  }
+
+  // Set the data pin HIGH or LOW - portable fallback.
+  void TM1651::dataWrite(uint8_t level) {
+    STATS51(this->statsEdge(0x02, level));
+    TRACE51(this->traceEdge(TRACE_DIO51, level));
+    digitalWrite(_dataPin, level);
+  }
+
+  // Set the data pin to INPUT or OUTPUT - portable fallback.
+  void TM1651::dataMode(uint8_t mode) {
+    TRACE51(this->traceEdge(TRACE_OUT51, mode == OUTPUT));
+    pinMode(_dataPin, mode);
+  }
+
+  // Read the data pin - portable fallback.
+  uint8_t TM1651::dataRead(void) {
+    uint8_t level = digitalRead(_dataPin);
+    TRACE51(this->traceEdge(TRACE_DIO51, level));         // The level driven by the TM1651, e.g. the ACK.
+    return(level);
+  }
+#endif
+
+#ifdef USEBUSSTATS51
+  // Count a pin change, if the pin level is different - the pin is given as a bit in _statsPins.
+  void TM1651::statsEdge(uint8_t pinBit, uint8_t level) {
+    if(((_statsPins & pinBit) != 0) != (level != LOW)) {
+      _statsPins ^= pinBit;
+      _stats.edges++;
+    }
+  }
+#endif
+
+#ifdef USEPINTRACE51
+  // Record a pin change in the trace, if the pin level is different - the oldest pin change is overwritten when the trace is full.
+  void TM1651::traceEdge(uint8_t pinBit, uint8_t level) {
+    uint8_t pins, index;
+    pins = (level != LOW) ? (_tracePins | pinBit) : (_tracePins & ~pinBit);
+    if(pins != _tracePins) {
+      _tracePins = pins;
+      if(_traceCount < TRACEBUF51) {
+        index = (_traceHead + _traceCount++) & (TRACEBUF51 - 1);
+      }
+      else {
+        index = _traceHead;
+        _traceHead = (_traceHead + 1) & (TRACEBUF51 - 1);
+      }
+      _trace[index].time = TRACETIME51();
+      _trace[index].pins = pins;
+    }
+  }
+
+  // Add the latency of a call to its histogram - bin 0 is 0-1us, and each bin after it is twice as wide, up to the last.
+  void TM1651::traceCall(uint8_t call, uint32_t startTime) {
+    uint32_t latency;
+    uint8_t bin = 0;
+    latency = TRACETIME51() - startTime;
+    while(latency > 1 && bin < (TRACEBINS51 - 1)) {
+      latency >>= 1;
+      bin++;
+    }
+    if(_traceHist[call][bin] < 0xffff) {                  // Saturate rather than wrap.
+      _traceHist[call][bin]++;
+    }
+  }
+#endif
+
+
+/************************************/
+/* Public USART SPI Class Functions */
+/************************************/
+
+#ifdef HASUSARTSPI51
+  // Class constructor - with the USART clock in Hz.
+  TM1651UsartSPI::TM1651UsartSPI(uint32_t clock) {
+    uint32_t ubrr = F_CPU / (2 * clock);                  // In master SPI mode the clock is F_CPU / (2 * (UBRR + 1)).
+    _ubrr = (ubrr > 0) ? ubrr - 1 : 0;
+    _ackWait = DEF_ACKWAIT51;
+  }
+
+  // Take the ACK wait of the bus timing profile - the USART sets the pace of the bits, the rest of the profile does not apply.
+  void TM1651UsartSPI::setTiming(TM1651Timing timing) {
+    _ackWait = timing.ackWait;
+  }
+
+  // Take over the USART0 pins, with the USART OFF and the bus idle (clock and data HIGH).
+  void TM1651UsartSPI::begin(void) {
+    UCSR0B = 0x00;
+    UCSR0C = 0x00;
+    this->pinWrite(_BV(PORTD4), HIGH);
+    this->pinWrite(_BV(PORTD1), HIGH);
+    DDRD |= _BV(DDD4) | _BV(DDD1);
+  }
+
+  // Send a start signal - data falling while the clock is high, bit banged.
+  void TM1651UsartSPI::start(void) {
+    this->pinWrite(_BV(PORTD4), HIGH);
+    this->pinWrite(_BV(PORTD1), HIGH);
+    delayMicroseconds(1);
+    this->pinWrite(_BV(PORTD1), LOW);
+    delayMicroseconds(1);
+    this->pinWrite(_BV(PORTD4), LOW);
+  }
+
+  // Start shifting out a byte, LSB first - the clock is low, so the USART can take over the pins without a start or stop signal.
+  void TM1651UsartSPI::writeByte(uint8_t data) {
+    UBRR0 = 0;                                            // As the datasheet, the baud rate is set after the transmitter is enabled.
+    UCSR0C = _BV(UMSEL01) | _BV(UMSEL00) | _BV(UDORD0);   // Master SPI mode 0, the clock idles low and the data is read on the rising edge, LSB first.
+    UCSR0B = _BV(TXEN0);
+    UBRR0 = _ubrr;
+    UCSR0A = _BV(TXC0);                                   // Clear the transmit complete flag.
+    UDR0 = data;
+  }
+
+  // Check if the byte is still being shifted out.
+  bool TM1651UsartSPI::busy(void) {
+    return(!(UCSR0A & _BV(TXC0)));
+  }
+
+  // Clock the ACK of the byte, bit banged - the USART has left the clock low after the 8th falling edge, so the TM1651 is pulling the data low.
+  bool TM1651UsartSPI::ack(void) {
+    bool acked;
+    this->pinWrite(_BV(PORTD4), LOW);
+    this->pinWrite(_BV(PORTD1), LOW);
+    DDRD &= ~_BV(DDD1);                                   // Release the data, without the pullup.
+    UCSR0B = 0x00;                                        // Hand the pins back from the USART.
+    UCSR0C = 0x00;
+    delayMicroseconds(_ackWait);
+    this->pinWrite(_BV(PORTD4), HIGH);
+    acked = !(PIND & _BV(PIND1));                         // ACK = LOW if the transfer was successful.
+    if(acked) {
+      DDRD |= _BV(DDD1);                                  // Hold the data low, so the TM1651 releasing it is not a stop signal.
+    }
+    delayMicroseconds(_ackWait);
+    this->pinWrite(_BV(PORTD4), LOW);                     // The TM1651 releases the data on the 9th falling edge.
+    DDRD |= _BV(DDD1);
+    return(acked);
+  }
+
+  // Send a stop signal - data rising while the clock is high, bit banged.
+  void TM1651UsartSPI::stop(void) {
+    this->pinWrite(_BV(PORTD4), LOW);
+    this->pinWrite(_BV(PORTD1), LOW);
+    delayMicroseconds(1);
+    this->pinWrite(_BV(PORTD4), HIGH);
+    delayMicroseconds(1);
+    this->pinWrite(_BV(PORTD1), HIGH);
+  }
+#endif
+
+
+/*************************************/
+/* Private USART SPI Class Functions */
+/*************************************/
+
+#ifdef HASUSARTSPI51
+  // Set the clock or data pin HIGH or LOW - direct port register write, atomic with respect to interrupts.
+  void TM1651UsartSPI::pinWrite(uint8_t mask, uint8_t level) {
+    uint8_t oldSREG = SREG;
+    cli();
+    if(level == LOW) {
+      PORTD &= ~mask;
+    }
+    else {
+      PORTD |= mask;
+    }
+    SREG = oldSREG;
+  }
+#endif
+
+
+/********************************/
+/* Public Array Class Functions */
+/********************************/
+
+// Class constructor - with an array of TM1651 modules that all share the same clock pin.
+TM1651Array::TM1651Array(TM1651* modules, uint8_t numModules) {
+  _modules = modules;
+  if(numModules > 0 && numModules <= MAX_MODULES51) {
+    _numModules = numModules;
+  }
+  else {
+    _numModules = 1;
+  }
+  _allModules = (1 << _numModules) - 1;
+}
+
+// Set up all the modules and initialise them, in parallel.
+void TM1651Array::begin(uint8_t numDigits, uint8_t brightness) {
+  uint8_t module;
+  for(module = 0; module < _numModules; module++) {
+    _modules[module]._tmDigitMap = TM1651::tmDigitMapDefault;
+    _modules[module]._addrAuto = _modules[0]._addrAuto;   // The modules share every frame, so they share the address mode of module 0.
+    _modules[module].setup(numDigits);                    // Set up the digits and the pins.
+    _modules[module]._updating = true;                    // Hold back the digit writes of every module for commit().
+    _modules[module].displayClear();                      // Record the clear display, all segments and decimal points.
+  }
+  #ifdef USEFASTPINIO51
+    // Check if all the data pins are in the same port as module 0, so each clock edge needs only one port write.
+    _samePort = true;
+    _dataMask = 0x00;
+    for(module = 0; module < _numModules; module++) {
+      if(_modules[module]._dataOut != _modules[0]._dataOut) {
+        _samePort = false;
+      }
+      _dataMask |= _modules[module]._dataMask;
+    }
+  #endif
+  this->commit();                                         // Clear all the displays.
+  this->displayBrightness(brightness);                    // Set all the displays to the chosen (or default) brightness.
+}
+
+// Turn all the module displays OFF, in parallel.
+void TM1651Array::displayOff(void) {
+  uint8_t module;
+  for(module = 0; module < _numModules; module++) {
+    _modules[module].cmdDispCtrl = DISP_OFF51;            // 0x80 = display OFF.
+  }
+  this->writeCommand(DISP_OFF51);                         // Turn all the displays OFF.
+}
+
+// Set the brightness (0x00 - 0x07) and turn all the module displays ON, in parallel.
+void TM1651Array::displayBrightness(uint8_t brightness) {
+  uint8_t module;
+  brightness &= INTENSITY_MAX51;
+  for(module = 0; module < _numModules; module++) {
+    _modules[module]._brightness = brightness;            // Record the TM1651 brightness level.
+    _modules[module].cmdDispCtrl = DISP_ON51 + brightness; // 0x88 + 0x00 to 0x07 brightness, 0x88 = display ON.
+  }
+  this->writeCommand(DISP_ON51 + brightness);             // Set the brightness and turn all the displays ON.
+}
+
+// Write the changed digits of all the modules, in parallel. Returns a bitmap of the modules that did not ACK, even after
+// the retries, bit 0 is module 0. Their digits are kept as changed, and they are rewritten in full by the next commit().
+uint8_t TM1651Array::commit(void) {
+  uint8_t module, digit, dirty = 0x00, resync = 0x00, nack = 0x00, length;
+  uint8_t frame[MAXFRAME51][MAX_MODULES51];
+  for(module = 0; module < _numModules; module++) {
+    _modules[module].flush();                             // Nothing else may be using the pins.
+    if(_modules[module]._resyncDue) {                     // A frame to this module failed, so rewrite its whole display.
+      _modules[module]._resyncDue = false;
+      _modules[module]._stats.resyncs++;
+      _modules[module]._cmdAddrMode = 0x00;               // The TM1651 address mode is no longer known.
+      _modules[module]._dirty = _modules[module].digitMask(); // The TM1651 display RAM is no longer known.
+      resync |= (1 << module);
+    }
+    dirty |= _modules[module]._dirty;                     // Collect the changed digits of all the modules.
+  }
+  if(dirty == 0x00) {
+    return(0x00);
+  }
+  if(resync) {
+    for(module = 0; module < _numModules; module++) {
+      frame[0][module] = _modules[module].cmdDispCtrl;    // Every module gets its own display control, it changes nothing on the others.
+    }
+    nack |= this->writeFrame(frame, 1);
+  }
+  if(_modules[0]._addrAuto) {
+    uint8_t lastDigit;
+    // Write everything from the first to the last changed digit of any module, in one burst to every module.
+    for(digit = 0; !(dirty & (1 << digit)); digit++);
+    for(lastDigit = MAX_DIGITS51 - 1; !(dirty & (1 << lastDigit)); lastDigit--);
+    nack |= this->writeAddrMode(ADDR_AUTO51);             // Cmd to set auto address mode.
+    for(module = 0; module < _numModules; module++) {
+      frame[0][module] = STARTADDR51 + digit;             // The digit start address is the same for every module.
+    }
+    for(length = 1; digit <= lastDigit; digit++, length++) {
+      for(module = 0; module < _numModules; module++) {
+        frame[length][module] = _modules[module]._image[digit]; // The current digit of every module.
+      }
+    }
+    nack |= this->writeFrame(frame, length);
+  }
+  else {
+    nack |= this->writeAddrMode(ADDR_FIXED51);            // Cmd to set specific address mode.
+    for(digit = 0; digit < MAX_DIGITS51; digit++) {
+      if(dirty & (1 << digit)) {
+        for(module = 0; module < _numModules; module++) {
+          frame[0][module] = STARTADDR51 + digit;         // The changed digits are already in physical address order.
+          frame[1][module] = _modules[module]._image[digit]; // The digit of every module.
+        }
+        nack |= this->writeFrame(frame, 2);
+      }
+    }
+  }
+  for(module = 0; module < _numModules; module++) {
+    if(!(nack & (1 << module))) {
+      _modules[module]._dirty = 0x00;                     // A module that failed keeps its changes, for its rewrite.
+    }
+  }
+  return(nack);
+}
+
+
+/*********************************/
+/* Private Array Class Functions */
+/*********************************/
+
+// Write an address mode command to all the modules, if any of them need it.
+uint8_t TM1651Array::writeAddrMode(uint8_t command) {
+  uint8_t module, needed = 0x00;
+  for(module = 0; module < _numModules; module++) {
+    if(_modules[module]._cmdAddrMode != command) {
+      _modules[module]._cmdAddrMode = command;
+      needed = 0x01;
+    }
+  }
+  if(needed) {
+    return(this->writeCommand(command));
+  }
+  return(0x00);
+}
+
+// Write the same command to all the modules. Returns a bitmap of the modules that did not ACK, even after the retries.
+uint8_t TM1651Array::writeCommand(uint8_t command) {
+  uint8_t module;
+  uint8_t frame[1][MAX_MODULES51];
+  for(module = 0; module < _numModules; module++) {
+    frame[0][module] = command;
+  }
+  return(this->writeFrame(frame, 1));
+}
+
+// Write a frame to all the modules, one column of bytes per module, with the retry policy and the bus statistics of module 0.
+// The frame is sent again to every module while any module does not ACK, as the modules share every clock edge. A module that
+// still does not ACK is marked for a rewrite of its whole display by the next commit(). Returns a bitmap of those modules.
+uint8_t TM1651Array::writeFrame(uint8_t frame[][MAX_MODULES51], uint8_t length) {
+  uint8_t tries, index, module, nack, byteNack;
+  for(tries = 0; ; tries++) {
+    nack = 0x00;
+    this->frameStart();
+    for(index = 0; index < length; index++) {
+      byteNack = this->frameBytes(frame[index]);
+      for(module = 0; module < _numModules; module++) {
+        _modules[module]._stats.bytes++;
+        if(byteNack & (1 << module)) {
+          _modules[module]._stats.nacks++;
+        }
+      }
+      nack |= byteNack;
+    }
+    this->frameEnd();
+    for(module = 0; module < _numModules; module++) {
+      _modules[module]._stats.frames++;
+    }
+    if(nack == 0x00 || tries >= _modules[0]._retries) {
+      break;
+    }
+    for(module = 0; module < _numModules; module++) {
+      _modules[module]._stats.retries++;
+    }
+  }
+  for(module = 0; module < _numModules; module++) {
+    if(nack & (1 << module)) {
+      _modules[module]._txNack = true;                    // Reported by the next flush() of the module.
+      _modules[module]._resyncDue = true;
+    }
+  }
+  return(nack);
+}
+
+// Start a frame to all the modules - as TM1651::start(), but with every data pin.
+void TM1651Array::frameStart(void) {
+  _modules[0].clkWrite(HIGH);
+  this->dataWrite(_allModules);
+  _modules[0].pinDelay(_modules[0]._timing.setup);
+  this->dataWrite(0x00);
+  _modules[0].pinDelay(_modules[0]._timing.clkHigh);
+  _modules[0].clkWrite(LOW);
+}
+
+// Write a byte to each of the modules - as TM1651::writeByte(), but with one data bit per module on each clock edge.
+uint8_t TM1651Array::frameBytes(uint8_t* bytes) {
+  uint8_t bit, module, levels, nack;
+  // Send 8 bits of data to every module.
+  for(bit = 0; bit < 8; bit++) {
+    _modules[0].clkWrite(LOW);
+    _modules[0].pinDelay(_modules[0]._timing.clkLow);
+    levels = 0x00;
+    for(module = 0; module < _numModules; module++) {
+      if(bytes[module] & (1 << bit)) {                    // LSB first.
+        levels |= (1 << module);
+      }
+    }
+    this->dataWrite(levels);
+    _modules[0].pinDelay(_modules[0]._timing.setup);
+    _modules[0].clkWrite(HIGH);
+    _modules[0].pinDelay(_modules[0]._timing.clkHigh);
+  }
+  // Wait for the ACKs.
+  _modules[0].clkWrite(LOW);
+  this->dataWrite(_allModules);
+  _modules[0].clkWrite(HIGH);
+  this->dataMode(INPUT, _allModules);
+  _modules[0].bitDelay();
+  nack = this->dataRead();                                // ACK = LOW if the transfer was successful.
+  if(nack != _allModules) {
+    this->dataMode(OUTPUT, _allModules & ~nack);
+    this->dataWrite(0x00);
+  }
+  _modules[0].bitDelay();
+  this->dataMode(OUTPUT, _allModules);
+  _modules[0].bitDelay();
+  return(nack);
+}
+
+// End the frame to all the modules - as TM1651::stop(), but with every data pin.
+void TM1651Array::frameEnd(void) {
+  _modules[0].clkWrite(LOW);
+  this->dataWrite(0x00);
+  _modules[0].pinDelay(_modules[0]._timing.setup);
+  _modules[0].clkWrite(HIGH);
+  _modules[0].pinDelay(_modules[0]._timing.clkHigh);
+  this->dataWrite(_allModules);
+}
+
+// Set the data pins HIGH or LOW, one bit per module - with a single port write if they are all in the same port.
+void TM1651Array::dataWrite(uint8_t levels) {
+  uint8_t module;
+  #ifdef USEFASTPINIO51
+    if(_samePort) {
+      uint8_t portBits = 0x00;
+      for(module = 0; module < _numModules; module++) {
+        if(levels & (1 << module)) {
+          portBits |= _modules[module]._dataMask;
+        }
+      }
+      uint8_t oldSREG = SREG;
+      cli();
+      *_modules[0]._dataOut = (*_modules[0]._dataOut & ~_dataMask) | portBits;
+      SREG = oldSREG;
+      return;
+    }
+  #endif
+  for(module = 0; module < _numModules; module++) {
+    _modules[module].dataWrite((levels & (1 << module)) ? HIGH : LOW);
+  }
+}
+
+// Set the data pins of the given modules to INPUT or OUTPUT - with a single port write if they are all in the same port.
+void TM1651Array::dataMode(uint8_t mode, uint8_t modules) {
+  uint8_t module;
+  #ifdef USEFASTPINIO51
+    if(_samePort) {
+      uint8_t portBits = 0x00;
+      for(module = 0; module < _numModules; module++) {
+        if(modules & (1 << module)) {
+          portBits |= _modules[module]._dataMask;
+        }
+      }
+      uint8_t oldSREG = SREG;
+      cli();
+      if(mode == INPUT) {                                 // As pinMode(), an INPUT also has its pullup turned OFF.
+        *_modules[0]._dataMode &= ~portBits;
+        *_modules[0]._dataOut  &= ~portBits;
+      }
+      else {
+        *_modules[0]._dataMode |= portBits;
+      }
+      SREG = oldSREG;
+      return;
+    }
+  #endif
+  for(module = 0; module < _numModules; module++) {
+    if(modules & (1 << module)) {
+      _modules[module].dataMode(mode);
+    }
+  }
+}
+
+// Read the data pins, one bit per module - with a single port read if they are all in the same port.
+uint8_t TM1651Array::dataRead(void) {
+  uint8_t module, levels = 0x00;
+  #ifdef USEFASTPINIO51
+    if(_samePort) {
+      uint8_t portBits = *_modules[0]._dataIn;
+      for(module = 0; module < _numModules; module++) {
+        if(portBits & _modules[module]._dataMask) {
+          levels |= (1 << module);
+        }
+      }
+      return(levels);
+    }
+  #endif
+  for(module = 0; module < _numModules; module++) {
+    if(_modules[module].dataRead() != LOW) {
+      levels |= (1 << module);
+    }
+  }
+  return(levels);
+}
+
+
+/************************************/
+/* Public Animation Class Functions */
+/************************************/
+
+// What an animation is playing.
+#define ANIM_NONE51     0                                 // Nothing.
+#define ANIM_FRAMES51   1                                 // Frames of raw segment codes from flash.
+#define ANIM_TEXT51     2                                 // A marquee of an ASCII string from RAM.
+#define ANIM_FLASH51    3                                 // A marquee of an ASCII string from flash.
+
+// A single segment circling the outside of a 3-digit display.
+const uint8_t tmAnimCircle51[] PROGMEM = {SEG_A51, 0x00,    0x00,                 // Along the top...
+                                          0x00,    SEG_A51, 0x00,
+                                          0x00,    0x00,    SEG_A51,
+                                          0x00,    0x00,    SEG_B51,              // ... down the right side...
+                                          0x00,    0x00,    SEG_C51,
+                                          0x00,    0x00,    SEG_D51,              // ... along the bottom...
+                                          0x00,    SEG_D51, 0x00,
+                                          SEG_D51, 0x00,    0x00,
+                                          SEG_E51, 0x00,    0x00,                 // ... and up the left side.
+                                          SEG_F51, 0x00,    0x00};
+
+// A dash bouncing between the borders of a 3-digit display.
+const uint8_t tmAnimBounce51[] PROGMEM = {SEG_G51 | SEG_E51 | SEG_F51, 0x00,    SEG_B51 | SEG_C51,
+                                          SEG_E51 | SEG_F51,           SEG_G51, SEG_B51 | SEG_C51,
+                                          SEG_E51 | SEG_F51,           0x00,    SEG_G51 | SEG_B51 | SEG_C51,
+                                          SEG_E51 | SEG_F51,           SEG_G51, SEG_B51 | SEG_C51};
+
+// Class constructor - with the display to animate.
+TM1651Animation::TM1651Animation(TM1651& display) : _display(display) {
+  _mode = ANIM_NONE51;
+  _starting = false;
+}
+
+// Play a sequence of frames of raw segment codes from flash, with a number of digits in each frame - a frame is shown from
+// the leftmost digit, any digits past its end are blank, and any codes past the end of the display are skipped.
+void TM1651Animation::playFrames(const uint8_t* frames, uint8_t numFrames, uint16_t interval, bool repeat, uint8_t frameWidth) {
+  if(frameWidth == 0) {
+    return;                                               // There is nothing to show.
+  }
+  _frameWidth = frameWidth;
+  this->play(frames, numFrames, interval, repeat, ANIM_FRAMES51);
+}
+
+// Scroll an ASCII string across the display, from the right - the string must not change while it is playing.
+void TM1651Animation::playMarquee(const char* text, uint16_t interval, bool repeat) {
+  this->play(reinterpret_cast<const uint8_t*>(text), strlen(text) + _display._numDigits, interval, repeat, ANIM_TEXT51);
+}
+
+// Scroll an ASCII string from flash, e.g. F("Hello"), across the display, from the right.
+void TM1651Animation::playMarquee(const __FlashStringHelper* text, uint16_t interval, bool repeat) {
+  const char* flashText = reinterpret_cast<const char*>(text);
+  this->play(reinterpret_cast<const uint8_t*>(flashText), strlen_P(flashText) + _display._numDigits, interval, repeat, ANIM_FLASH51);
+}
+
+// Stop playing, leaving the current frame on the display.
+void TM1651Animation::stop(void) {
+  _mode = ANIM_NONE51;
+}
+
+// Check if an animation or marquee is playing.
+bool TM1651Animation::playing(void) {
+  return(_mode != ANIM_NONE51);
+}
+
+// Show the next frame when it is due - call often with millis(), it never waits.
+void TM1651Animation::tick(uint32_t timeNow) {
+  if(_starting) {                                         // The first frame is timed by the caller's clock only.
+    _lastTime = timeNow;
+    _starting = false;
+  }
+  else if(_mode != ANIM_NONE51 && (timeNow - _lastTime) >= _interval) {
+    _lastTime = timeNow;
+    if(_frame >= _numFrames) {                            // The end of the sequence.
+      if(!_repeat) {
+        _mode = ANIM_NONE51;
+        return;
+      }
+      _frame = 0;
+    }
+    this->showFrame();
+  }
+}
+
+
+/*************************************/
+/* Private Animation Class Functions */
+/*************************************/
+
+// Start playing a sequence, showing the first frame straight away, for an interval from the next tick().
+void TM1651Animation::play(const uint8_t* frames, uint16_t numFrames, uint16_t interval, bool repeat, uint8_t mode) {
+  _frames = frames;
+  _numFrames = numFrames;
+  _interval = interval;
+  _repeat = repeat;
+  _mode = mode;
+  _frame = 0;
+  _starting = true;
+  this->showFrame();
+}
+
+// Show the next frame, or marquee step, on the display - only the digits that differ from the display are written.
+void TM1651Animation::showFrame(void) {
+  uint8_t digit, numDigits, character;
+  int16_t index;
+  numDigits = _display._numDigits;
+  for(digit = 0; digit < numDigits; digit++) {
+    if(_mode == ANIM_FRAMES51) {
+      _display.setRegister(digit, (digit < _frameWidth) ? pgm_read_byte(&_frames[_frame * _frameWidth + digit]) & 0x7f : 0x00);
+    }
+    else {
+      // The marquee starts with the first character in the rightmost digit, and ends with the text just off the left.
+      index = _frame + digit - numDigits + 1;
+      character = 0x00;
+      if(index >= 0 && index < (int16_t)(_numFrames - numDigits)) {
+        character = (_mode == ANIM_TEXT51) ? _frames[index] : pgm_read_byte(&_frames[index]);
+      }
+      _display.setRegister(digit, (character >= 0x20 && character <= 0x7f) ? pgm_read_byte(&TM1651::tmAsciiTable[character - 0x20]) : 0x00);
+    }
+  }
+  _display.writeChanged();
+  _frame++;
+}
+
+
+/********************************/
+/* Public Fader Class Functions */
+/********************************/
+
+// Class constructor - with the display to fade.
+TM1651Fader::TM1651Fader(TM1651& display) : _display(display) {
+  _level = 0;
+  _rate = FADE_RATE51;
+  _error = 0;
+  _hwLevel = 0xff;                                        // The display brightness is not yet known.
+  _fading = false;
+  _starting = false;
+  _offAtEnd = false;
+  _active = false;                                        // Leave the display brightness alone until told otherwise.
+  _lastTime = 0;
+}
+
+// Set the fade level (0 - 112) straight away, stopping any fade.
+void TM1651Fader::setLevel(uint8_t level) {
+  _level = (level > FADE_MAX51) ? FADE_MAX51 : level;
+  _fading = false;
+  _offAtEnd = false;
+  _active = true;
+}
+
+// Set the minimum time in ms between brightness commands - this bounds the bus traffic, and the dithering rate.
+void TM1651Fader::setRate(uint8_t rate) {
+  _rate = rate;
+}
+
+// Fade to a level (0 - 112) over a time in ms, timed from the next tick() so only the caller's clock is used.
+void TM1651Fader::fadeTo(uint8_t level, uint16_t duration) {
+  _startLevel = _level;
+  _endLevel = (level > FADE_MAX51) ? FADE_MAX51 : level;
+  _duration = duration;
+  _starting = true;                                       // The fade is timed from the next tick().
+  _fading = true;
+  _offAtEnd = false;
+  _active = true;
+}
+
+// Turn the display ON and fade up from the dimmest to a level (0 - 112) over a time in ms.
+void TM1651Fader::fadeIn(uint8_t level, uint16_t duration) {
+  _level = 0;
+  _hwLevel = 0xff;                                        // Force a brightness command, turning the display ON.
+  this->fadeTo(level, duration);
+}
+
+// Fade down to the dimmest over a time in ms, then turn the display OFF.
+void TM1651Fader::fadeOut(uint16_t duration) {
+  this->fadeTo(0, duration);
+  _offAtEnd = true;
+}
+
+// Check if a fade is in progress.
+bool TM1651Fader::fading(void) {
+  return(_fading);
+}
+
+// Update the fade and the dithering - call often with millis(), it never waits, and sends at most one command per rate period.
+void TM1651Fader::tick(uint32_t timeNow) {
+  uint32_t elapsed;
+  uint8_t hwLevel;
+  if(_starting) {                                         // The fade starts now, timed by the caller's clock.
+    _startTime = timeNow;
+    _starting = false;
+  }
+  if(!_active || (timeNow - _lastTime) < _rate) {         // Nothing to do, or not yet time for another brightness command slot.
+    return;
+  }
+  _lastTime = timeNow;
+  if(_fading) {
+    elapsed = timeNow - _startTime;
+    if(elapsed >= _duration) {                            // The fade has finished.
+      _level = _endLevel;
+      _fading = false;
+      if(_offAtEnd) {
+        _active = false;                                  // Leave the display alone until the next fade.
+        _hwLevel = 0xff;                                  // The next brightness command must turn the display back ON.
+        _display.displayOff();
+        return;
+      }
+    }
+    else {
+      _level = _startLevel + (int16_t)(((int32_t)(_endLevel - _startLevel) * (int32_t)elapsed) / _duration);
+    }
+  }
+  // Dither between the two nearest hardware levels, carrying the error so the average matches the fade level.
+  hwLevel = _level / FADE_STEPS51;
+  _error += _level % FADE_STEPS51;
+  if(_error >= FADE_STEPS51) {
+    _error -= FADE_STEPS51;
+    hwLevel++;
+  }
+  if(hwLevel != _hwLevel) {                               // Only send a command when the hardware level changes.
+    _hwLevel = hwLevel;
+    _display.displayBrightness(hwLevel);
+  }
+}
+
+
+/********************************/
+/* Public Meter Class Functions */
+/********************************/
+
+// The 7 bars of a battery level module, segments a - g of digit 0.
+const uint8_t tmMeterBattery51[] PROGMEM = {tmMeterStep51(0, 'a'), tmMeterStep51(0, 'b'), tmMeterStep51(0, 'c'), tmMeterStep51(0, 'd'),
+                                            tmMeterStep51(0, 'e'), tmMeterStep51(0, 'f'), tmMeterStep51(0, 'g')};
+
+// Class constructor - with the display, and a layout of steps in flash, from the lowest to the highest.
+TM1651Meter::TM1651Meter(TM1651& display, const uint8_t* layout, uint8_t numSteps) : _display(display) {
+  _layout = layout;
+  _numSteps = numSteps;
+  _target = 0;
+  _level = 0;                                             // The meter LEDs are OFF after begin() or displayClear().
+  _peak = 0;
+  _peakHeld = 0;
+  _hold = 0;                                              // No peak.
+  _decay = 0;                                             // The level falls straight away.
+  _levelTime = 0;
+  _peakTime = 0;
+  _levelStart = false;
+  _peakStart = false;
+}
+
+// Set the level (0 - number of steps) - it rises straight away, and falls at the decay rate, timed from the next tick().
+void TM1651Meter::setLevel(uint8_t level) {
+  uint8_t oldLevel, oldPeak;
+  oldLevel = _level;
+  oldPeak = _peak;
+  if(_level <= _target) {                                 // The level was not falling, so any fall starts at the next tick().
+    _levelStart = true;
+  }
+  _target = (level > _numSteps) ? _numSteps : level;
+  if(_target >= _level || _decay == 0) {
+    _level = _target;
+  }
+  if(_hold > 0 && _level >= _peak) {                      // A new peak, hold it.
+    _peak = _level;
+    _peakHeld = _level;
+    _peakStart = true;                                    // The hold starts at the next tick().
+  }
+  this->show(oldLevel, oldPeak);
+}
+
+// Set the time in ms the peak is held before it falls, 0 turns the peak OFF.
+void TM1651Meter::setPeakHold(uint16_t hold) {
+  uint8_t oldPeak;
+  _hold = hold;
+  if(_hold == 0) {
+    oldPeak = _peak;
+    _peak = 0;
+    this->show(_level, oldPeak);
+  }
+}
+
+// Set the time in ms for the level and the peak to fall by one step, 0 falls straight away.
+void TM1651Meter::setDecay(uint16_t decay) {
+  _decay = decay;
+}
+
+// Write every step of the meter again, e.g. after the display has been cleared.
+void TM1651Meter::redraw(void) {
+  uint8_t step;
+  for(step = 0; step < _numSteps; step++) {
+    this->showStep(step);
+  }
+  _display.writeChanged();
+}
+
+// Update the decay and the peak hold - call often with millis(), it never waits, and only writes the digits that change.
+void TM1651Meter::tick(uint32_t timeNow) {
+  uint32_t elapsed, steps;
+  uint8_t oldLevel, oldPeak;
+  oldLevel = _level;
+  oldPeak = _peak;
+  if(_levelStart) {                                       // Time the fall and the hold by the caller's clock only.
+    _levelTime = timeNow;
+    _levelStart = false;
+  }
+  if(_peakStart) {
+    _peakTime = timeNow;
+    _peakStart = false;
+  }
+  if(_level > _target) {                                  // Fall towards the target, catching up any missed steps.
+    elapsed = timeNow - _levelTime;
+    steps = (_decay == 0) ? (_level - _target) : elapsed / _decay;
+    if(steps >= (uint32_t)(_level - _target)) {
+      _level = _target;
+    }
+    else {
+      _level -= steps;
+    }
+    _levelTime += steps * _decay;
+  }
+  if(_peak > _level) {                                    // Hold the peak, then let it fall, but never below the level.
+    elapsed = timeNow - _peakTime;
+    if(elapsed >= _hold) {
+      steps = (_decay == 0) ? _peakHeld : (elapsed - _hold) / _decay + 1;
+      _peak = (steps >= (uint32_t)(_peakHeld - _level)) ? _level : _peakHeld - steps;
+    }
+  }
+  if(_level != oldLevel || _peak != oldPeak) {
+    this->show(oldLevel, oldPeak);
+  }
+}
+
+
+/*********************************/
+/* Private Meter Class Functions */
+/*********************************/
+
+// Check if a step is lit - every step below the level, and the step at the peak.
+bool TM1651Meter::lit(uint8_t step) {
+  return(step < _level || (_peak > _level && step == _peak - 1));
+}
+
+// Record a step ON or OFF in its digit, leaving the other segments of the digit alone.
+void TM1651Meter::showStep(uint8_t step) {
+  uint8_t digit, bit, value;
+  digit = pgm_read_byte(&_layout[step]);
+  bit = digit & 0x0f;
+  digit >>= 4;
+  if(digit < _display._numDigits && bit < 7) {            // Ignore any step that is not a segment of the display.
+    value = _display.readRegister(digit);
+    if(this->lit(step)) {
+      value |= (1 << bit);
+    }
+    else {
+      value &= ~(1 << bit);
+    }
+    _display.setRegister(digit, value);                   // The digit is only recorded as changed if the segment has changed.
+  }
+}
+
+// Write the steps that have changed since the given level and peak - the steps between the levels, and the old and new peaks.
+void TM1651Meter::show(uint8_t oldLevel, uint8_t oldPeak) {
+  uint8_t step, last;
+  step = (oldLevel < _level) ? oldLevel : _level;
+  last = (oldLevel < _level) ? _level : oldLevel;
+  for(; step < last; step++) {
+    this->showStep(step);
+  }
+  if(oldPeak != _peak) {
+    if(oldPeak > 0) {
+      this->showStep(oldPeak - 1);
+    }
+    if(_peak > 0) {
+      this->showStep(_peak - 1);
+    }
+  }
+  _display.writeChanged();                                // All the changed digits are written together.
+}
+
+
+/*********************************/
+/* Public Stream Class Functions */
+/*********************************/
+
+// Class constructor - with the display, and the stream to read the frames from.
+TM1651Stream::TM1651Stream(TM1651& display, Stream& stream) : _display(display), _stream(stream) {
+  _head = 0;
+  _count = 0;
+  _bright = STREAMNONE51;
+  _rateBytes = 0;
+  _rateTime = 0;
+  this->resetStats();
+}
+
+// Decode the waiting frames, and write all the digits they change together - call often with millis(), it never waits.
+// An update the caller holds, e.g. by a TM1651Array, stays held, and its digits are written by the caller's commit().
+void TM1651Stream::tick(uint32_t timeNow) {
+  bool moreBytes, updating = _display._updating;
+  _display._updating = true;                              // Hold back the digit writes...
+  do {
+    // Move the waiting bytes from the stream into the ring buffer, as far as there is room.
+    while(_count < STREAMBUF51 && _stream.available() > 0) {
+      _buffer[(_head + _count) & (STREAMBUF51 - 1)] = _stream.read();
+      _count++;
+    }
+    moreBytes = (_count == STREAMBUF51);                  // A full buffer might leave more bytes waiting in the stream.
+  } while(this->decode() && moreBytes);
+  _display._updating = updating;
+  _display.writeChanged();                                // ... and write only the changed digits in one go, unless the caller holds them.
+  if(_bright != STREAMNONE51) {                           // A brightness change goes after the digits of the frames before it.
+    if(_bright > INTENSITY_MAX51) {
+      _display.displayOff();
+    }
+    else {
+      _display.displayBrightness(_bright);
+    }
+    _bright = STREAMNONE51;
+  }
+  if(timeNow - _rateTime >= STREAMRATE51) {               // The end of a throughput measuring period.
+    _stats.rate = (_rateBytes * 1000UL) / (timeNow - _rateTime);
+    _rateBytes = 0;
+    _rateTime = timeNow;
+  }
+}
+
+// Get the stream statistics.
+TM1651StreamStats TM1651Stream::getStats(void) {
+  return(_stats);
+}
+
+// Reset the stream statistics to zero.
+void TM1651Stream::resetStats(void) {
+  _stats.frames  = 0;
+  _stats.bytes   = 0;
+  _stats.dropped = 0;
+  _stats.rate    = 0;
+}
+
+
+/**********************************/
+/* Private Stream Class Functions */
+/**********************************/
+
+// Get a byte from the ring buffer, counting from the oldest.
+uint8_t TM1651Stream::peekByte(uint8_t index) {
+  return(_buffer[(_head + index) & (STREAMBUF51 - 1)]);
+}
+
+// Decode the complete frames in the ring buffer, straight from the buffer. Returns true if any bytes were used.
+bool TM1651Stream::decode(void) {
+  uint8_t length, check, index, used;
+  bool progress = false;
+  while(_count > 0) {
+    used = 1;                                             // Skip a byte that does not start a good frame, and look for the next sync.
+    if(this->peekByte(0) == STREAMSYNC51) {
+      if(_count < 3) {                                    // Wait for the op and the length.
+        break;
+      }
+      length = this->peekByte(2);
+      if(length > STREAMMAXLEN51) {
+        _stats.dropped++;
+      }
+      else {
+        if(_count < length + 4) {                         // Wait for the rest of the frame.
+          break;
+        }
+        check = 0x00;
+        for(index = 1; index < length + 3; index++) {     // The check is the xor of the op, the length and the payload.
+          check ^= this->peekByte(index);
+        }
+        if(check != this->peekByte(length + 3)) {
+          _stats.dropped++;
+        }
+        else {
+          used = length + 4;
+          if(this->execute(this->peekByte(1), length)) {
+            _stats.frames++;
+            _stats.bytes += used;
+            _rateBytes += used;
+          }
+          else {
+            _stats.dropped++;
+          }
+        }
+      }
+    }
+    _head = (_head + used) & (STREAMBUF51 - 1);
+    _count -= used;
+    progress = true;
+  }
+  return(progress);
+}
+
+// Carry out the op of the frame at the start of the ring buffer. Returns false if the op, or its payload, is not valid.
+bool TM1651Stream::execute(uint8_t op, uint8_t length) {
+  uint8_t digit, index;
+  switch(op) {
+    case OP_RAW51:
+      digit = this->peekByte(3);
+      if(length < 2 || digit + length - 1 > _display._numDigits) {
+        return(false);
+      }
+      for(index = 4; index < length + 3; index++, digit++) {
+        _display.setRegister(digit, this->peekByte(index) & 0x7f); // Record the raw segment codes, only the changed digits are written.
+      }
+      return(true);
+    case OP_NUMBER51:
+      if(length != 6) {
+        return(false);
+      }
+      _display.displayNumber(this->peekByte(3), this->peekByte(4), (int16_t)(this->peekByte(5) | (this->peekByte(6) << 8)), this->peekByte(7), this->peekByte(8));
+      return(true);
+    case OP_BRIGHT51:
+      if(length != 1) {
+        return(false);
+      }
+      _bright = (this->peekByte(3) > INTENSITY_MAX51) ? (INTENSITY_MAX51 + 1) : this->peekByte(3); // Sent after the digits, the last one wins.
+      return(true);
+    case OP_DP51:
+      if(length != 1) {
+        return(false);
+      }
+      _display.displayDP(this->peekByte(3) != 0);
+      return(true);
+  }
+  return(false);
 }
 
-// EOF
\ No newline at end of file
+// EOF
@@ -44,8 +44,35 @@
   #define ON              HIGH
   #define OFF             LOW
 
-  // Compile time control for the TM1651 addressing mode.
+  // Compile time default for the TM1651 addressing mode - each instance can also choose its own, e.g. with TM1651T.
   #define USEADDRAUTOMODE51
+  #ifdef USEADDRAUTOMODE51
+    #define DEF_ADDRAUTO51 true
+  #else
+    #define DEF_ADDRAUTO51 false
+  #endif
+
+  // Compile time control for the TM1651 pin access - direct port register writes where the architecture allows it.
+  #if defined(__AVR__)
+    #define USEFASTPINIO51
+  #endif
+
+  // Compile time control for the USART in master SPI mode transport - only where the USART0 clock (XCK0) pin is on the board.
+  #if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega328__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega168P__)
+    #define HASUSARTSPI51
+  #endif
+
+  // Compile time control for the TM1651 transmit mode - define this to queue the frames and send them from service().
+  //#define USEASYNCMODE51
+
+  // Compile time control for the TM1651 bus statistics - define this to also count the pin changes and delays.
+  //#define USEBUSSTATS51
+
+  // Compile time control for the displayNumber() memo - define this to remember the last number shown in each run of digits.
+  //#define USENUMBERMEMO51
+
+  // Compile time control for the TM1651 pin trace - define this to record every pin change with a timestamp, for timing profiling.
+  //#define USEPINTRACE51
 
   // Command and address definitions for the TM1651.
   #define ADDR_AUTO51     0x40
@@ -69,19 +96,180 @@
   #define DEF_DIGITS51    3                               // The LEDC68 module has 3 7-segment digits, addressed 0x00 - 0x02.
   #define MAX_DIGITS51    4
 
+  // Default bus timing profile in us, change them here to change them at compile time - each instance can also set its own with setTiming().
+  #ifdef USEFASTPINIO51
+    #define DEF_CLKHIGH51 1                               // Clock high time - direct port writes are too quick for the TM1651 without this.
+    #define DEF_CLKLOW51  0                               // Clock low time before the data changes.
+    #define DEF_SETUP51   1                               // Data setup time before the clock rises.
+  #else
+    #define DEF_CLKHIGH51 0                               // digitalWrite() is slow enough without any extra delay.
+    #define DEF_CLKLOW51  0
+    #define DEF_SETUP51   0
+  #endif
+  #define DEF_ACKWAIT51   5                               // Wait for the TM1651 at each step of the ACK.
+
+  // Bus timing calibration definitions.
+  #define CAL_FRAMES51    16                              // The number of frames that must all be acknowledged for a timing to pass.
+  #define CAL_MARGIN51    1                               // The safety margin in us added to each timing, over the shortest that passed.
+
+  // Transfer error recovery definitions.
+  #define DEF_RETRIES51   2                               // The default number of times a frame that was not acknowledged is sent again.
+
+  // USART in master SPI mode transport definitions.
+  #define USARTCLKPIN51   4                               // The TM1651 clock must be on the USART0 clock pin, XCK0 = PD4 = D4.
+  #define USARTDIOPIN51   1                               // The TM1651 data must be on the USART0 transmit pin, TXD0 = PD1 = D1.
+  #define USARTCLK51      250000UL                        // The default USART clock in Hz.
+
+  // Pin trace definitions, change them here to change them at compile time.
+  #define TRACEBUF51      64                              // The number of pin changes in the trace ring buffer, a power of 2 up to 128.
+  #define TRACETIME51()   micros()                        // The trace timestamp, e.g. a cycle counter for a finer resolution.
+  #define TRACESCALE51    "1us"                           // The time of one timestamp count, in VCD units.
+  #define TRACEBINS51     8                               // The number of latency histogram bins: 0-1us, 2-3us, 4-7us ... 128us and over.
+
+  // Asynchronous transmit queue definitions.
+  #define TXQUEUE51       16                              // The size of the transmit queue in bytes, this must be a power of 2.
+  #define MAXFRAME51      (1 + MAX_DIGITS51)              // The largest frame is an address followed by every digit.
+
+  // Definitions for the 7 segment display segments, see the register bits above.
+  #define SEG_A51         0x01
+  #define SEG_B51         0x02
+  #define SEG_C51         0x04
+  #define SEG_D51         0x08
+  #define SEG_E51         0x10
+  #define SEG_F51         0x20
+  #define SEG_G51         0x40
+
+  // The number of codes in the character code table.
+  #define CHARTABLESIZE51 47
+
+  // Number formatting definitions for displayNumber(), the format flags can be combined.
+  #define NUM_BLANK51     0x00                            // The default - decimal, right aligned, with the leading zeros blanked.
+  #define NUM_ZEROS51     0x20                            // Keep the leading zeros, filling the whole run of digits.
+  #define NUM_LEFT51      0x40                            // Left aligned, with the blanks on the right.
+  #define NUM_HEX51       0x80                            // Hexadecimal, the number is taken as unsigned.
+  #define NUM_DECIMALS51  0x03                            // The most decimal places in a fixed point number.
+
+  // Build a 7 segment character code from the letters of its segments at compile time, e.g. tmSegments51("bc") is a 1.
+  constexpr uint8_t tmSegments51(const char* segments) {
+    return(*segments ? (uint8_t)(((*segments >= 'a' && *segments <= 'g') ? (SEG_A51 << (*segments - 'a')) : 0x00) | tmSegments51(segments + 1)) : 0x00);
+  }
+
+  // The ASCII font, 0x20 (space) - 0x7f, with a blank for anything that cannot be shown on 7 segments.
+  #define ASCIIFONT51 \
+    tmSegments51(""),       tmSegments51(""),       tmSegments51("bf"),     tmSegments51(""),       /*   ! " # */ \
+    tmSegments51("acdfg"),  tmSegments51(""),       tmSegments51(""),       tmSegments51("b"),      /* $ % & ' */ \
+    tmSegments51("adef"),   tmSegments51("abcd"),   tmSegments51(""),       tmSegments51(""),       /* ( ) * + */ \
+    tmSegments51("c"),      tmSegments51("g"),      tmSegments51(""),       tmSegments51("beg"),    /* , - . / */ \
+    tmSegments51("abcdef"), tmSegments51("bc"),     tmSegments51("abdeg"),  tmSegments51("abcdg"),  /* 0 1 2 3 */ \
+    tmSegments51("bcfg"),   tmSegments51("acdfg"),  tmSegments51("acdefg"), tmSegments51("abc"),    /* 4 5 6 7 */ \
+    tmSegments51("abcdefg"),tmSegments51("abcfg"),  tmSegments51(""),       tmSegments51(""),       /* 8 9 : ; */ \
+    tmSegments51(""),       tmSegments51("dg"),     tmSegments51(""),       tmSegments51("abeg"),   /* < = > ? */ \
+    tmSegments51("abcdeg"), tmSegments51("abcefg"), tmSegments51("cdefg"),  tmSegments51("adef"),   /* @ A B C */ \
+    tmSegments51("bcdeg"),  tmSegments51("adefg"),  tmSegments51("aefg"),   tmSegments51("acdef"),  /* D E F G */ \
+    tmSegments51("bcefg"),  tmSegments51("ef"),     tmSegments51("bcde"),   tmSegments51("acefg"),  /* H I J K */ \
+    tmSegments51("def"),    tmSegments51("ace"),    tmSegments51("abcef"),  tmSegments51("abcdef"), /* L M N O */ \
+    tmSegments51("abefg"),  tmSegments51("abcfg"),  tmSegments51("eg"),     tmSegments51("acdfg"),  /* P Q R S */ \
+    tmSegments51("defg"),   tmSegments51("bcdef"),  tmSegments51("bcdef"),  tmSegments51("bdf"),    /* T U V W */ \
+    tmSegments51("bcefg"),  tmSegments51("bcdfg"),  tmSegments51("abdeg"),  tmSegments51("adef"),   /* X Y Z [ */ \
+    tmSegments51("cfg"),    tmSegments51("abcd"),   tmSegments51("abf"),    tmSegments51("d"),      /* \ ] ^ _ */ \
+    tmSegments51("f"),      tmSegments51("abcdeg"), tmSegments51("cdefg"),  tmSegments51("deg"),    /* ` a b c */ \
+    tmSegments51("bcdeg"),  tmSegments51("abdefg"), tmSegments51("aefg"),   tmSegments51("abcdfg"), /* d e f g */ \
+    tmSegments51("cefg"),   tmSegments51("e"),      tmSegments51("cd"),     tmSegments51("acefg"),  /* h i j k */ \
+    tmSegments51("ef"),     tmSegments51("ce"),     tmSegments51("ceg"),    tmSegments51("cdeg"),   /* l m n o */ \
+    tmSegments51("abefg"),  tmSegments51("abcfg"),  tmSegments51("eg"),     tmSegments51("acdfg"),  /* p q r s */ \
+    tmSegments51("defg"),   tmSegments51("cde"),    tmSegments51("cde"),    tmSegments51("bdf"),    /* t u v w */ \
+    tmSegments51("bcefg"),  tmSegments51("bcdfg"),  tmSegments51("abdeg"),  tmSegments51("bcg"),    /* x y z { */ \
+    tmSegments51("ef"),     tmSegments51("efg"),    tmSegments51("a"),      tmSegments51("")        /* | } ~   */
+
+  // A compile time copy of the ASCII font - it is never defined, so it is never stored in SRAM, and any run time use fails to link.
+  struct TMAsciiFont51 {
+    static constexpr uint8_t font[] = {ASCIIFONT51};
+  };
+
+  // The code of an ASCII character, worked out by the compiler.
+  template<uint8_t CHARACTER> struct TMAsciiCode51 {
+    enum : uint8_t {code = (CHARACTER >= 0x20 && CHARACTER <= 0x7f) ? TMAsciiFont51::font[CHARACTER - 0x20] : 0x00};
+  };
+
+  // Encode an ASCII character at compile time, e.g. static const uint8_t hi[] = {tmAscii51('H'), tmAscii51('i')};
+  // The character must be a constant, at run time use displayString(), which reads the font from flash.
+  #define tmAscii51(character) ((uint8_t)TMAsciiCode51<(uint8_t)(character)>::code)
+
+  // The TM1651 bus statistics - the pin changes and delays are only counted, and only exist, when USEBUSSTATS51 is defined.
+  struct TM1651Stats {
+    uint32_t frames;                                      // The number of frames sent, start signal to stop signal, including any retries.
+    uint32_t bytes;                                       // The number of bytes sent, commands, addresses and data.
+    uint32_t nacks;                                       // The number of bytes that were not acknowledged.
+    uint32_t retries;                                     // The number of frames sent again because they were not acknowledged.
+    uint32_t resyncs;                                     // The number of times the whole display was rewritten because the retries failed.
+    #ifdef USEBUSSTATS51
+      uint32_t edges;                                     // The number of clock and data pin changes.
+      uint32_t delays;                                    // The number of bitDelay() waits.
+    #endif
+  };
+
+  // A TM1651 bus timing profile, all in us.
+  struct TM1651Timing {
+    uint8_t clkHigh;                                      // The clock high time, after the clock rises.
+    uint8_t clkLow;                                       // The clock low time, after the clock falls and before the data changes.
+    uint8_t setup;                                        // The data setup time, after the data changes and before the clock rises.
+    uint8_t ackWait;                                      // The wait at each step of the ACK, the start of a frame and between async steps.
+  };
+
+  // The interface to a TM1651 transport, anything that can send the start signal, the bytes and the stop signal of the frames.
+  class TM1651Transport {
+    public:
+      virtual void begin(void) {}                         // Take over the pins, called by TM1651::setTransport().
+      virtual void setTiming(TM1651Timing) {}             // Take the bus timing profile, e.g. the ACK wait, called by TM1651::setTransport() and setTiming().
+      virtual void start(void) = 0;                       // Send a start signal.
+      virtual void writeByte(uint8_t) = 0;                // Start shifting out a byte, LSB first.
+      virtual bool busy(void) = 0;                        // Check if the byte is still being shifted out.
+      virtual bool ack(void) = 0;                         // Clock the ACK of the byte. Returns true if it was acknowledged.
+      virtual void stop(void) = 0;                        // Send a stop signal.
+  };
+
+  #ifdef HASUSARTSPI51
+    // A TM1651 transport that shifts out each byte with USART0 in master SPI mode, and only bit bangs the start, stop and ACK.
+    class TM1651UsartSPI : public TM1651Transport {
+      public:
+        // TM1651UsartSPI Class instantiation - with the USART clock in Hz.
+        TM1651UsartSPI(uint32_t = USARTCLK51);
+        void begin(void);                                 // Take over the USART0 pins, with the bus idle.
+        void setTiming(TM1651Timing);                     // Take the ACK wait of the bus timing profile.
+        void start(void);                                 // Send a start signal.
+        void writeByte(uint8_t);                          // Start shifting out a byte, LSB first.
+        bool busy(void);                                  // Check if the byte is still being shifted out.
+        bool ack(void);                                   // Clock the ACK of the byte. Returns true if it was acknowledged.
+        void stop(void);                                  // Send a stop signal.
+      private:
+        uint16_t _ubrr;                                   // The USART baud rate register value for the clock.
+        uint8_t _ackWait;                                 // The wait in us at each step of the bit banged ACK.
+        void pinWrite(uint8_t, uint8_t);                  // Set the clock or data pin HIGH or LOW.
+    };
+  #endif
+
+  class TM1651Array;
+  class TM1651Animation;
+  class TM1651Meter;
+  class TM1651Stream;
+
   class TM1651 {
+    friend class TM1651Array;                             // The array drives the pins and digits of its modules directly.
+    friend class TM1651Animation;                         // The animations write the digits of their display directly.
+    friend class TM1651Meter;                             // The level meters write the segments of their display directly.
+    friend class TM1651Stream;                            // The stream front-ends write the digits of their display directly.
     public:
       // TM1651 Class instantiation.
-      TM1651(uint8_t = DEF_TM_CLK51, uint8_t = DEF_TM_DIN51, bool = true);
+      TM1651(uint8_t = DEF_TM_CLK51, uint8_t = DEF_TM_DIN51, bool = true, bool = DEF_ADDRAUTO51);
       uint8_t cmdDispCtrl;                                // The current display control command.
-      uint8_t charTableSize;                              // The size of the defined character code table.
-      static uint8_t tmCharTable[];                       // This is a class variable, shared across all class instances.
+      static const uint8_t charTableSize = CHARTABLESIZE51; // The size of the defined character code table.
+      static const uint8_t tmCharTable[];                 // This is a class variable in flash (PROGMEM), shared across all class instances.
+      static const uint8_t tmAsciiTable[];                // The ASCII font, 0x20 - 0x7f, also in flash (PROGMEM).
+      static uint8_t charCode(uint8_t);                   // Get a code from the character code table.
       // Set up the display and initialise it with defaults values - with the default or no digit map.
       void begin(uint8_t = DEF_DIGITS51, uint8_t = INTENSITY_TYP51);
-      #ifndef USEADDRAUTOMODE51
-        // Set up the display and initialise it with defaults values - with a supplied digit map.
-        void begin(uint8_t*, uint8_t = DEF_DIGITS51, uint8_t = INTENSITY_TYP51);
-      #endif
+      // Set up the display and initialise it with defaults values - with a supplied digit map.
+      void begin(uint8_t*, uint8_t = DEF_DIGITS51, uint8_t = INTENSITY_TYP51);
       // Set up the display and initialise it with default values.
       void displayOff(void);                              // Turn the TM1651 display OFF.
       void displayClear(void);                            // Clear all the digits in the display.
@@ -91,28 +279,385 @@
       void displayInt8(uint8_t, uint8_t, bool = true);    // Display a decimal integer between 0 - 99, or a hex integer between 0x00 - 0xff, starting at a specific digit.
       void displayInt12(uint8_t, uint16_t, bool = true);  // Display a decimal integer between 0 - 999, or a hex integer between 0x000 - 0xfff, starting at a specific digit.
       void displayInt16(uint8_t, uint16_t, bool = true);  // Display a decimal integer between 0 - 9999, or a hex integer between 0x0000 - 0xffff, starting at a specific digit.
+      void displayString(uint8_t, const char*);           // Display an ASCII string, starting at a specific digit.
+      void displayString(uint8_t, const __FlashStringHelper*); // Display an ASCII string from flash, e.g. F("Hi"), starting at a specific digit.
+      void displayText(uint8_t, const uint8_t*, uint8_t); // Display a run of raw segment codes, e.g. from tmAscii51(), starting at a specific digit.
+      void displayIncrement(uint8_t, uint8_t, bool = true); // Increment the number displayed in a run of digits, only changing the digits that roll over.
+      void displayNumber(uint8_t, uint8_t, int16_t, uint8_t = 0, uint8_t = NUM_BLANK51); // Display a signed or fixed point number in a run of digits, skipping it if it is unchanged.
       void displayDP(bool = OFF);                         // Turn ON/OFF the decimal points.
-    private:
+      uint8_t readRegister(uint8_t);                      // Get the recorded segment value of a digit (or the LEDC68 DP control at +0x03).
+      void beginUpdate(void);                             // Start a display update, holding back the digit writes until commit().
+      void commit(void);                                  // Finish a display update, writing only the changed digits to the TM1651.
+      void service(void);                                 // Send the next step of any queued frames - call from loop(), yield() or a timer interrupt.
+      bool busy(void);                                    // Check if there are queued frames still being sent.
+      bool flush(void);                                   // Wait for all the queued frames to be sent, and check they were all acknowledged in the end.
+      void setRetries(uint8_t = DEF_RETRIES51);           // Set the number of times a frame that was not acknowledged is sent again.
+      TM1651Stats getStats(void);                         // Get the bus statistics.
+      void resetStats(void);                              // Reset the bus statistics to zero.
+      void setTransport(TM1651Transport*);                // Set the transport that sends the frames, or nullptr to bit bang the pins.
+      void setTiming(TM1651Timing);                       // Set the bus timing profile.
+      TM1651Timing getTiming(void);                       // Get the bus timing profile.
+      TM1651Timing calibrate(void);                       // Find the fastest bus timing that the module acknowledges reliably, use it and return it.
+      #ifdef USEPINTRACE51
+        void traceVCD(Print&);                            // Write the pin trace as a VCD file, for PulseView or GTKWave.
+        void traceSummary(Print&);                        // Write the latency histograms of the start, writeByte and stop calls, or their service() steps.
+        void traceClear(void);                            // Clear the pin trace and the latency histograms.
+      #endif
+    protected:
       bool _LEDC68;                                       // Flag if we have a Gotek LEDC68 module - affects only the decimal point control.
+      bool _addrAuto;                                     // Flag if the TM1651 auto address mode is used, otherwise the fixed address mode.
       uint8_t _clkPin;                                    // The current TM1651 clock pin.
       uint8_t _dataPin;                                   // The current TM1651 data pin.
       uint8_t _numDigits;                                 // The number of TM1651 module digits.
       uint8_t _brightness;                                // The current TM1651 display brightness.
       uint8_t _registers[MAX_DIGITS51] = {0};             // An array used to hold the LED display digit values.
-      #ifndef USEADDRAUTOMODE51
-        uint8_t* _tmDigitMap;                             // A pointer to the physical to logical digit mapping.
-        static uint8_t tmDigitMapDefault[];               // An array to hold the default physical to logical digit mapping.
+      uint8_t _image[MAX_DIGITS51] = {0};                 // The transmit image, the digit values in the physical address order of the digit map.
+      uint8_t _dirty;                                     // A bitmap of the physical addresses changed since they were last written to the TM1651.
+      #ifdef USENUMBERMEMO51
+        int16_t _memoNumber[MAX_DIGITS51];                // The last number shown by displayNumber(), for each starting digit.
+        uint8_t _memoConfig[MAX_DIGITS51] = {0};          // The format, decimals and number of digits it was shown with, or 0 if it has been overwritten.
+        uint8_t _memoDigits;                              // A bitmap of the digits (+dp) covered by the remembered numbers.
+      #endif
+      uint8_t _cmdAddrMode;                               // The current address mode command, so it is only sent when it changes.
+      bool _updating;                                     // Flag if the digit writes are being held back until commit().
+      TM1651Transport* _transport;                        // The transport that sends the frames, or nullptr to bit bang the pins.
+      TM1651Timing _timing;                               // The bus timing profile.
+      TM1651Stats _stats;                                 // The bus statistics.
+      #ifdef USEBUSSTATS51
+        uint8_t _statsPins;                               // The last clock (bit 0) and data (bit 1) pin levels, to count the pin changes.
+      #endif
+      #ifdef USEPINTRACE51
+        static_assert(TRACEBUF51 >= 2 && TRACEBUF51 <= 128 && (TRACEBUF51 & (TRACEBUF51 - 1)) == 0,
+                      "The trace buffer must be a power of 2, up to 128 pin changes.");
+        struct TraceEvent {
+          uint32_t time;                                  // The timestamp of the pin change.
+          uint8_t pins;                                   // The clock (bit 0), data (bit 1) and data direction (bit 2) after the change.
+        };
+        TraceEvent _trace[TRACEBUF51];                    // The trace ring buffer, the oldest pin changes are overwritten.
+        uint8_t _traceHead;                               // The index of the oldest pin change in the trace ring buffer.
+        uint8_t _traceCount;                              // The number of pin changes in the trace ring buffer.
+        uint8_t _tracePins;                               // The current clock, data and data direction.
+        uint16_t _traceHist[3][TRACEBINS51];              // The latency histograms of the start, writeByte and stop calls.
+      #endif
+      volatile bool _txNack;                              // Flag if a frame was not acknowledged, even after its retries, since the last flush().
+      uint8_t _retries;                                   // The number of times a frame that was not acknowledged is sent again.
+      volatile bool _resyncDue;                           // Flag if the whole display must be rewritten, because a frame failed.
+      bool _resyncing;                                    // Flag if the whole display is being rewritten, or calibrated, so a failure does not start another.
+      #ifdef USEASYNCMODE51
+        uint8_t _txQueue[TXQUEUE51];                      // The transmit queue, each frame is a byte count followed by the bytes.
+        volatile uint8_t _txHead;                         // The transmit queue index after the last complete frame.
+        volatile uint8_t _txTail;                         // The transmit queue index of the next byte to be sent.
+        volatile uint8_t _txRetry;                        // The transmit queue index of the frame being sent, kept until it is acknowledged.
+        uint8_t _txFrame;                                 // The transmit queue index of the byte count of the frame being queued.
+        uint8_t _txNext;                                  // The transmit queue index for the next byte of the frame being queued.
+        volatile uint8_t _txState;                        // The current step of the transmit state machine.
+        uint8_t _txBytes;                                 // The number of bytes left to send in the current frame.
+        uint8_t _txData;                                  // The bits left to send in the current byte.
+        uint8_t _txBit;                                   // The number of bits sent of the current byte.
+        uint8_t _txTries;                                 // The number of retries of the frame being sent.
+        bool _txFrameNack;                                // Flag if a byte of the frame being sent was not acknowledged.
+        volatile bool _txLock;                            // Flag if service() is already running, in case it is also called from an interrupt.
+        #ifdef USEPINTRACE51
+          uint32_t _txTraceStart;                         // The time the start, byte or stop being sent began, for its latency histogram.
+        #endif
+      #endif
+      #ifndef USEASYNCMODE51
+        uint8_t _frame[MAXFRAME51];                       // A copy of the frame being sent, in case it has to be sent again.
+        uint8_t _frameLen;                                // The number of bytes in the frame being sent.
+        bool _frameNack;                                  // Flag if a byte of the frame being sent was not acknowledged.
+      #endif
+      #ifdef USEFASTPINIO51
+        volatile uint8_t* _clkOut;                        // The clock pin output (PORTx) register.
+        volatile uint8_t* _dataOut;                       // The data pin output (PORTx) register.
+        volatile uint8_t* _dataMode;                      // The data pin direction (DDRx) register.
+        volatile uint8_t* _dataIn;                        // The data pin input (PINx) register.
+        uint8_t _clkMask;                                 // The clock pin bitmask within its port.
+        uint8_t _dataMask;                                // The data pin bitmask within its port.
       #endif
+      uint8_t* _tmDigitMap;                               // A pointer to the physical to logical digit mapping.
+      static uint8_t tmDigitMapDefault[];                 // An array to hold the default physical to logical digit mapping.
+      void setup(uint8_t);                                // Set up the digits and the pins, ready for the display to be initialised.
+      uint8_t digitMask(void);                            // Get a bitmap of the physical addresses of all the digits in use (+dp if there is one).
+      uint8_t physDigit(uint8_t);                         // Get the physical address of a logical digit.
+      void setNumber(uint8_t, uint8_t, uint16_t, bool);   // Record the digits of a decimal or hex number.
+      static void decDigits(uint16_t, uint8_t, uint8_t*); // Split a decimal number into its digit values, most significant first.
+      #ifdef USENUMBERMEMO51
+        uint8_t memoMask(uint8_t);                        // Get a bitmap of the digits (+dp) covered by a remembered number.
+        void forgetNumbers(uint8_t);                      // Forget the remembered numbers covering any of the given digits.
+      #endif
+      void setRegister(uint8_t, uint8_t);                 // Record a new value for a digit, marking it as changed if it is different.
+      void writeChanged(void);                            // Write all the changed digits to the TM1651.
+      void writeAddrMode(uint8_t);                        // Write an address mode command to the TM1651, if it is not already set.
       void writeCommand(uint8_t);                         // Write a command to the TM1651.
-      #ifndef USEADDRAUTOMODE51
-        void writeDigit(uint8_t);                         // Write the given logical digit value to the correct physical digit.
-      #else
-        void writeDigit(uint8_t, uint8_t = 1);            // Write the given logical digit values to the correct physical digits.
+      void resync(void);                                  // Rewrite the display control, address mode and every digit to the TM1651.
+      void writeDigit(uint8_t);                           // Write the transmit image value of a physical address, in fixed address mode.
+      void writeDigits(uint8_t, uint8_t);                 // Write the transmit image values of a run of physical addresses in one burst, in auto address mode.
+      #ifdef USEASYNCMODE51
+        void txNextByte(void);                            // Get the next byte of the frame from the transmit queue.
+        void txFrameDone(void);                           // Queue the frame again if it was not acknowledged, or free its space.
       #endif
+      void frameStart(void);                              // Start a frame to the TM1651.
+      void frameByte(uint8_t);                            // Add a byte of data to the frame.
+      void frameEnd(void);                                // End the frame to the TM1651.
       bool writeByte(uint8_t);                            // Write a byte of data to the TM1651.
       void start(void);                                   // Send a start signal to the TM1651.
       void stop(void);                                    // Send a stop signal to the TM1651.
       void bitDelay(void);                                // Wait for a bit...
+      void pinDelay(uint8_t);                             // Wait for one of the bus timing profile times.
+      bool calibrateTest(void);                           // Check that a burst of frames is acknowledged with the current bus timing.
+      void calibrateStep(uint8_t&);                       // Reduce one bus timing while it passes, then add the margin.
+      void clkWrite(uint8_t);                             // Set the clock pin HIGH or LOW.
+      void dataWrite(uint8_t);                            // Set the data pin HIGH or LOW.
+      void dataMode(uint8_t);                             // Set the data pin to INPUT or OUTPUT.
+      uint8_t dataRead(void);                             // Read the data pin.
+      #ifdef USEBUSSTATS51
+        void statsEdge(uint8_t, uint8_t);                 // Count a pin change, if the pin level is different.
+      #endif
+      #ifdef USEPINTRACE51
+        void traceEdge(uint8_t, uint8_t);                 // Record a pin change in the trace, if the pin level is different.
+        void traceCall(uint8_t, uint32_t);                // Add the latency of a call to its histogram.
+      #endif
+  };
+
+  // A TM1651 display with compile time bounds checking only - the configuration and the digits of the templated functions are
+  // checked by the compiler. Everything else is a plain TM1651, the address mode, the pins and the LEDC68 handling are decided
+  // at run time, as for any TM1651.
+  template<uint8_t CLKPIN, uint8_t DIOPIN, uint8_t DIGITS = DEF_DIGITS51, bool ADDRAUTO = DEF_ADDRAUTO51, bool LEDC68 = true>
+  class TM1651T : public TM1651 {
+    static_assert(CLKPIN != DIOPIN, "The clock and data pins must be different.");
+    static_assert(DIGITS > 0 && DIGITS <= MAX_DIGITS51, "The TM1651 supports 1 - 4 digits.");
+    static_assert(!LEDC68 || DIGITS == 3, "The LEDC68 module has 3 digits.");
+    public:
+      using TM1651::displayChar;
+      using TM1651::displayInt8;
+      using TM1651::displayInt12;
+      using TM1651::displayInt16;
+      using TM1651::displayNumber;
+      // TM1651T Class instantiation - everything is already known.
+      TM1651T() : TM1651(CLKPIN, DIOPIN, LEDC68, ADDRAUTO) {}
+      // Set up the display and initialise it with defaults values - with the default or no digit map.
+      void begin(uint8_t brightness = INTENSITY_TYP51) {
+        TM1651::begin(DIGITS, brightness);
+      }
+      // Set up the display and initialise it with defaults values - with a supplied digit map.
+      void begin(uint8_t* tmDigitMap, uint8_t brightness = INTENSITY_TYP51) {
+        TM1651::begin(tmDigitMap, DIGITS, brightness);
+      }
+      // Display a character in a digit checked at compile time, e.g. displayChar<1>(5).
+      template<uint8_t DIGIT> void displayChar(uint8_t number, bool raw = false) {
+        static_assert(DIGIT < DIGITS, "The digit is beyond the last digit.");
+        this->setRegister(DIGIT, raw ? (number & 0x7f) : charCode((number < charTableSize) ? number : 0x20));
+        this->writeChanged();
+      }
+      // Display a decimal integer between 0 - 99, or a hex integer between 0x00 - 0xff, starting at a digit checked at compile time.
+      template<uint8_t DIGIT> void displayInt8(uint8_t number, bool useDec = true) {
+        static_assert(DIGIT + 2 <= DIGITS, "An 8-bit number needs 2 digits.");
+        this->setNumber(DIGIT, 2, (useDec && number > 99) ? 99 : number, useDec);
+        this->writeChanged();
+      }
+      // Display a decimal integer between 0 - 999, or a hex integer between 0x000 - 0xfff, starting at a digit checked at compile time.
+      template<uint8_t DIGIT> void displayInt12(uint16_t number, bool useDec = true) {
+        static_assert(DIGIT + 3 <= DIGITS, "A 12-bit number needs 3 digits.");
+        this->setNumber(DIGIT, 3, (number > (useDec ? 999 : 0xfff)) ? (useDec ? 999 : 0xfff) : number, useDec);
+        this->writeChanged();
+      }
+      // Display a decimal integer between 0 - 9999, or a hex integer between 0x0000 - 0xffff, starting at a digit checked at compile time.
+      template<uint8_t DIGIT> void displayInt16(uint16_t number, bool useDec = true) {
+        static_assert(DIGIT + 4 <= DIGITS, "A 16-bit number needs 4 digits.");
+        this->setNumber(DIGIT, 4, (useDec && number > 9999) ? 9999 : number, useDec);
+        this->writeChanged();
+      }
+      // Display a signed or fixed point number in a run of digits checked at compile time, e.g. displayNumber<0, 3>(-42).
+      template<uint8_t DIGIT, uint8_t NUMDIGITS> void displayNumber(int16_t number, uint8_t decimals = 0, uint8_t format = NUM_BLANK51) {
+        static_assert(NUMDIGITS > 0 && DIGIT + NUMDIGITS <= DIGITS, "The run of digits goes beyond the last digit.");
+        TM1651::displayNumber(DIGIT, NUMDIGITS, number, decimals, format);
+      }
+      // Turn ON/OFF the decimal points - this is nothing at all without an LEDC68 module.
+      void displayDP(bool status = OFF) {
+        if(LEDC68) {
+          this->setRegister(0x03, status ? DP_ON51 : DP_OFF51);
+          this->writeChanged();
+        }
+      }
+  };
+
+  // Parallel multi-module definitions.
+  #define MAX_MODULES51   8                               // The most TM1651 modules that can share a clock pin in an array.
+
+  class TM1651Array {
+    public:
+      // TM1651Array Class instantiation - with an array of TM1651 modules that all share the same clock pin.
+      TM1651Array(TM1651*, uint8_t);
+      void begin(uint8_t = DEF_DIGITS51, uint8_t = INTENSITY_TYP51); // Set up all the modules and initialise them, in parallel.
+      void displayOff(void);                              // Turn all the module displays OFF, in parallel.
+      void displayBrightness(uint8_t = INTENSITY_TYP51);  // Set the brightness and turn all the module displays ON, in parallel.
+      uint8_t commit(void);                               // Write the changed digits of all the modules, in parallel, rewriting any module that failed.
+    private:
+      TM1651* _modules;                                   // The TM1651 modules, module 0 provides the shared clock pin.
+      uint8_t _numModules;                                // The number of TM1651 modules.
+      uint8_t _allModules;                                // A bitmap of all the modules, bit 0 is module 0.
+      #ifdef USEFASTPINIO51
+        bool _samePort;                                   // Flag if all the data pins are in the same port, so they can be written together.
+        uint8_t _dataMask;                                // The bitmask of all the data pins in their port.
+      #endif
+      uint8_t writeAddrMode(uint8_t);                     // Write an address mode command to all the modules, if any need it.
+      uint8_t writeCommand(uint8_t);                      // Write the same command to all the modules.
+      uint8_t writeFrame(uint8_t[][MAX_MODULES51], uint8_t); // Write a frame to all the modules, sending it again while any module does not ACK.
+      void frameStart(void);                              // Start a frame to all the modules.
+      uint8_t frameBytes(uint8_t*);                       // Write a byte to each of the modules.
+      void frameEnd(void);                                // End the frame to all the modules.
+      void dataWrite(uint8_t);                            // Set the data pins HIGH or LOW, one bit per module.
+      void dataMode(uint8_t, uint8_t);                    // Set the data pins of the given modules to INPUT or OUTPUT.
+      uint8_t dataRead(void);                             // Read the data pins, one bit per module.
+  };
+
+  // Built in animations, each is a sequence of 3-digit frames of raw segment codes in flash.
+  #define ANIMWIDTH51     3                               // The number of digits in each frame of the built in animations.
+  #define ANIMCIRCLE51    10                              // The number of frames in the circle animation.
+  #define ANIMBOUNCE51    4                               // The number of frames in the bounce animation.
+  extern const uint8_t tmAnimCircle51[];                  // A single segment circling the outside of a 3-digit display.
+  extern const uint8_t tmAnimBounce51[];                  // A dash bouncing between the borders of a 3-digit display.
+
+  class TM1651Animation {
+    public:
+      // TM1651Animation Class instantiation - with the display to animate.
+      TM1651Animation(TM1651&);
+      void playFrames(const uint8_t*, uint8_t, uint16_t, bool = true, uint8_t = ANIMWIDTH51); // Play a sequence of frames of raw segment codes from flash.
+      void playMarquee(const char*, uint16_t, bool = true); // Scroll an ASCII string across the display.
+      void playMarquee(const __FlashStringHelper*, uint16_t, bool = true); // Scroll an ASCII string from flash, e.g. F("Hello"), across the display.
+      void stop(void);                                    // Stop playing, leaving the current frame on the display.
+      bool playing(void);                                 // Check if an animation or marquee is playing.
+      void tick(uint32_t);                                // Show the next frame when it is due - call often with millis().
+    private:
+      TM1651& _display;                                   // The display being animated.
+      const uint8_t* _frames;                             // The frames, or the marquee text.
+      uint16_t _numFrames;                                // The number of frames, or marquee steps, in the sequence.
+      uint16_t _frame;                                    // The next frame, or marquee step, to show.
+      uint16_t _interval;                                 // The time between frames in ms.
+      uint8_t _frameWidth;                                // The number of digits in each frame.
+      uint32_t _lastTime;                                 // The time the last frame was shown.
+      uint8_t _mode;                                      // What is playing - nothing, frames, or a marquee from RAM or flash.
+      bool _repeat;                                       // Flag if the sequence repeats when it reaches the end.
+      bool _starting;                                     // Flag if the first frame is timed from the next tick().
+      void play(const uint8_t*, uint16_t, uint16_t, bool, uint8_t); // Start playing a sequence.
+      void showFrame(void);                               // Show the next frame, or marquee step, on the display.
+  };
+
+  // Brightness fading definitions.
+  #define FADE_STEPS51    16                              // The number of fade steps between each hardware brightness level.
+  #define FADE_MAX51      (INTENSITY_MAX51 * FADE_STEPS51) // The brightest fade level, 0 is the dimmest.
+  #define FADE_RATE51     2                               // The default minimum time in ms between brightness commands.
+
+  class TM1651Fader {
+    public:
+      // TM1651Fader Class instantiation - with the display to fade.
+      TM1651Fader(TM1651&);
+      void setLevel(uint8_t);                             // Set the fade level (0 - 112) straight away.
+      void setRate(uint8_t);                              // Set the minimum time in ms between brightness commands.
+      void fadeTo(uint8_t, uint16_t);                     // Fade to a level (0 - 112) over a time in ms, from the next tick().
+      void fadeIn(uint8_t, uint16_t);                     // Turn the display ON and fade up from the dimmest to a level (0 - 112) over a time in ms.
+      void fadeOut(uint16_t);                             // Fade down to the dimmest over a time in ms, then turn the display OFF.
+      bool fading(void);                                  // Check if a fade is in progress.
+      void tick(uint32_t);                                // Update the fade and the dithering - call often with millis().
+    private:
+      TM1651& _display;                                   // The display being faded.
+      uint8_t _level;                                     // The current fade level.
+      uint8_t _startLevel;                                // The fade level at the start of the fade.
+      uint8_t _endLevel;                                  // The fade level at the end of the fade.
+      uint16_t _duration;                                 // The time the fade takes in ms.
+      uint32_t _startTime;                                // The time the fade started.
+      uint32_t _lastTime;                                 // The time of the last brightness command slot.
+      uint8_t _rate;                                      // The minimum time in ms between brightness commands.
+      uint8_t _error;                                     // The dithering error, carried between the brightness command slots.
+      uint8_t _hwLevel;                                   // The hardware brightness level last sent, or 0xff if it must be sent.
+      bool _fading;                                       // Flag if a fade is in progress.
+      bool _starting;                                     // Flag if the fade starts at the next tick().
+      bool _offAtEnd;                                     // Flag if the display is turned OFF at the end of the fade.
+      bool _active;                                       // Flag if the fader is controlling the display brightness.
+  };
+
+  // Level meter definitions.
+  #define METERBATTERY51  7                               // The number of steps in the battery level layout.
+
+  // Build a level meter layout step, the LED at a segment ('a' - 'g') of a digit, at compile time, e.g. tmMeterStep51(0, 'a').
+  constexpr uint8_t tmMeterStep51(uint8_t digit, char segment) {
+    return((uint8_t)((digit << 4) | (segment - 'a')));
+  }
+
+  // Built in level meter layouts, each is a sequence of steps in flash, from the lowest to the highest.
+  extern const uint8_t tmMeterBattery51[];                // The 7 bars of a battery level module, segments a - g of digit 0.
+
+  class TM1651Meter {
+    public:
+      // TM1651Meter Class instantiation - with the display, and a layout of steps in flash.
+      TM1651Meter(TM1651&, const uint8_t*, uint8_t);
+      void setLevel(uint8_t);                             // Set the level (0 - number of steps), it rises straight away and falls at the decay rate.
+      void setPeakHold(uint16_t);                         // Set the time in ms the peak is held, 0 turns the peak OFF.
+      void setDecay(uint16_t);                            // Set the time in ms for the level and the peak to fall by one step, 0 falls straight away.
+      void redraw(void);                                  // Write every step of the meter again, e.g. after the display has been cleared.
+      void tick(uint32_t);                                // Update the decay and the peak hold - call often with millis().
+    private:
+      TM1651& _display;                                   // The display showing the meter.
+      const uint8_t* _layout;                             // The steps of the meter, (digit << 4) | segment bit, in flash.
+      uint8_t _numSteps;                                  // The number of steps in the layout.
+      uint8_t _target;                                    // The level being metered.
+      uint8_t _level;                                     // The level on the display, it falls to the target at the decay rate.
+      uint8_t _peak;                                      // The peak on the display, or 0 if there is no peak.
+      uint8_t _peakHeld;                                  // The peak level when it was set.
+      uint16_t _hold;                                     // The time in ms the peak is held before it falls.
+      uint16_t _decay;                                    // The time in ms for the level and the peak to fall by one step.
+      uint32_t _levelTime;                                // The time the level last fell, or was set.
+      uint32_t _peakTime;                                 // The time the peak was set.
+      bool _levelStart;                                   // Flag if the fall of the level is timed from the next tick().
+      bool _peakStart;                                    // Flag if the peak hold is timed from the next tick().
+      bool lit(uint8_t);                                  // Check if a step is lit.
+      void showStep(uint8_t);                             // Record a step ON or OFF in its digit.
+      void show(uint8_t, uint8_t);                        // Write the steps that have changed since the given level and peak.
+  };
+
+  // Stream front-end definitions, change the buffer size here to change it at compile time.
+  #define STREAMBUF51     32                              // The size of the receive ring buffer, a power of 2 up to 128.
+  #define STREAMSYNC51    0xA5                            // The first byte of every frame: sync, op, length, payload, xor check.
+  #define STREAMMAXLEN51  6                               // The longest payload, a number.
+  #define STREAMRATE51    1000                            // The time in ms over which the throughput is measured.
+  #define STREAMNONE51    0xff                            // No brightness change is waiting to be sent.
+
+  // Stream front-end frame ops.
+  #define OP_RAW51        0x01                            // Raw segment codes: digit, code, ...
+  #define OP_NUMBER51     0x02                            // A number: digit, number of digits, number low, number high, decimals, format.
+  #define OP_BRIGHT51     0x03                            // The brightness: 0 - 7, or anything higher turns the display OFF.
+  #define OP_DP51         0x04                            // The LEDC68 decimal point: 0 = OFF, anything else = ON.
+
+  // Stream front-end statistics.
+  struct TM1651StreamStats {
+    uint32_t frames;                                      // The number of good frames decoded.
+    uint32_t bytes;                                       // The number of bytes in the good frames.
+    uint32_t dropped;                                     // The number of frames dropped for a bad length, check or op.
+    uint32_t rate;                                        // The throughput in bytes/s of good frames, over the last measuring period.
+  };
+
+  class TM1651Stream {
+    public:
+      // TM1651Stream Class instantiation - with the display, and the stream to read the frames from.
+      TM1651Stream(TM1651&, Stream&);
+      void tick(uint32_t);                                // Decode the waiting frames and write the changed digits together - call often with millis().
+      TM1651StreamStats getStats(void);                   // Get the stream statistics.
+      void resetStats(void);                              // Reset the stream statistics to zero.
+    private:
+      static_assert(STREAMBUF51 >= (STREAMMAXLEN51 + 4) && STREAMBUF51 <= 128 && (STREAMBUF51 & (STREAMBUF51 - 1)) == 0,
+                    "The stream buffer must be a power of 2, large enough for a frame, and no more than 128 bytes.");
+      TM1651& _display;                                   // The display being driven.
+      Stream& _stream;                                    // The stream the frames are read from.
+      uint8_t _buffer[STREAMBUF51];                       // The receive ring buffer.
+      uint8_t _head;                                      // The index of the oldest byte in the ring buffer.
+      uint8_t _count;                                     // The number of bytes in the ring buffer.
+      uint8_t _bright;                                    // The brightness change waiting for the digits, or STREAMNONE51.
+      uint32_t _rateBytes;                                // The bytes of good frames in this measuring period.
+      uint32_t _rateTime;                                 // The time this measuring period started.
+      TM1651StreamStats _stats;                           // The stream statistics.
+      uint8_t peekByte(uint8_t);                          // Get a byte from the ring buffer, counting from the oldest.
+      bool decode(void);                                  // Decode the frames in the ring buffer.
+      bool execute(uint8_t, uint8_t);                     // Carry out the op of the frame at the start of the ring buffer.
   };
 #endif
 
@@ -39,6 +39,9 @@
 // Instantiate a TM1651 display.
 TM1651 myDisplay(CLKPIN, DIOPIN, LEDC68);                 // Set clock and data pins and declare that we have an LEDC68 module.
 
+// Instantiate an animation player for the TM1651 display.
+TM1651Animation myAnimation(myDisplay);
+
 void setup() {
   pinMode(LEDPIN, OUTPUT);
   digitalWrite(LEDPIN, OFF);
@@ -49,12 +52,18 @@ void setup() {
   // TM1651 fixed addressing mode using a supplied digit map.
   // Digits = 3, Brightness = 2, Display cleared (all segments OFF and decimal points OFF).
   //myDisplay.begin(tmDigitMap, NUMDIGITS, INTENSITY_TYP51);
+  Serial.println("\nBus timing calibration.");
+  calibrateBus();
   Serial.println("\nDisplay physical to logical mapping test.");
   findDigitMap();
   Serial.println("\nDisplay brightness and digit tests.");
   testDisplay();
   blinkLED(100);
   delay(1000);
+  Serial.println("\nDisplay animation and marquee tests.");
+  testAnimation();
+  blinkLED(100);
+  delay(1000);
 }
 
 void loop() {
@@ -110,6 +119,23 @@ void blinkLED(uint32_t interval) {
   digitalWrite(LEDPIN, OFF);
 }
 
+void calibrateBus() {
+  TM1651Timing timing, defaultTiming;
+  // Find the fastest reliable bus timing, and report it so it can be pinned with setTiming() - the demo keeps the default timing.
+  defaultTiming = myDisplay.getTiming();
+  timing = myDisplay.calibrate();
+  myDisplay.setTiming(defaultTiming);
+  Serial.print("Clock high: ");
+  Serial.print(timing.clkHigh);
+  Serial.print("us, clock low: ");
+  Serial.print(timing.clkLow);
+  Serial.print("us, data setup: ");
+  Serial.print(timing.setup);
+  Serial.print("us, ACK wait: ");
+  Serial.print(timing.ackWait);
+  Serial.println("us");
+}
+
 void findDigitMap() {
   byte digit, counter;
   // Map the digits, physical to logical.
@@ -168,6 +194,23 @@ void testDisplay() {
   myDisplay.displayClear();
 }
 
+void testAnimation() {
+  unsigned long timeMark;
+  // Circle the display for 3 seconds, the animation plays without blocking while tick() is called.
+  myAnimation.playFrames(tmAnimCircle51, ANIMCIRCLE51, 100);
+  timeMark = millis();
+  while(millis() - timeMark < 3000) {
+    myAnimation.tick(millis());
+  }
+  // Scroll a message across the display, once.
+  myAnimation.playMarquee(F("HELLO 1651"), 300, false);
+  while(myAnimation.playing()) {
+    myAnimation.tick(millis());
+  }
+  // Ensure we clear the display as we leave the animation test function.
+  myDisplay.displayClear();
+}
+
 void countHex8(uint32_t interval) {
   byte counter = 0;
   myDisplay.displayChar(0, 0x12);                         // Print an "h" in the 1st digit.
@@ -191,10 +234,12 @@ void countHex12(uint32_t interval) {
 
 void countUp(uint16_t number, uint32_t interval) {
   int16_t counter;
-  for(counter = 0; counter <= number; counter++) {
-    myDisplay.displayInt12(0, counter);                   // Print the 0 - 999 count in the 1st, 2nd and 3rd digits.
+  myDisplay.displayInt12(0, 0);                           // Print the 0 count in the 1st, 2nd and 3rd digits.
+  for(counter = 1; counter <= number; counter++) {
     delay(interval);
+    myDisplay.displayIncrement(0, 3);                     // Count up to 999, only writing the digits that roll over.
   }
+  delay(interval);
   // Ensure we clear the display (+dps) as we leave the count up function.
   myDisplay.displayClear();
 }
@@ -216,9 +261,11 @@ void countXMins(byte minutesMax) {
   }
   for(minutes = 0; minutes < minutesMax; minutes++) {
     for(seconds = 0; seconds < 60; seconds++) {
+      myDisplay.beginUpdate();                            // Hold back the digit writes...
       myDisplay.displayChar(0, minutes);                  // Print the minutes in the 1st digit.
       myDisplay.displayChar(1, seconds / 10);             // Print the seconds (x10) in the 2nd digit.
       myDisplay.displayChar(2, seconds % 10);             // Print the seconds (units) in the 3rd digit.
+      myDisplay.commit();                                 // ... and write only the changed digits in one go.
       delay(1000);
     }
   }
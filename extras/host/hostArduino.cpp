@@ -0,0 +1,163 @@
+/*!
+ * A host (Linux) stand-in for the Arduino core - the simulated pins and clock.
+ *
+ * ****************************
+ * *  Host Arduino Code File  *
+ * ****************************
+*/
+
+#include <Arduino.h>
+
+#define MAX_DEVICES     16                                // The most devices that can be attached to the pins.
+
+volatile uint8_t hostPORT[HOSTPORTS];
+volatile uint8_t hostDDR[HOSTPORTS];
+volatile uint8_t hostPIN[HOSTPORTS];
+HostSREG SREG = {0x80};
+uint32_t hostPinAccesses = 0;
+
+static uint32_t hostMicros = 0;                           // The simulated clock in us.
+static HostDevice* hostDevices[MAX_DEVICES];              // The devices attached to the pins.
+static uint8_t hostNumDevices = 0;
+
+// Attach a device to the pins.
+HostDevice::HostDevice(void) {
+  if(hostNumDevices < MAX_DEVICES) {
+    hostDevices[hostNumDevices++] = this;
+  }
+}
+
+// Detach a device from the pins.
+HostDevice::~HostDevice(void) {
+  uint8_t device;
+  for(device = 0; device < hostNumDevices; device++) {
+    if(hostDevices[device] == this) {
+      hostDevices[device] = hostDevices[--hostNumDevices];
+      break;
+    }
+  }
+}
+
+// Get the level of a pin on the bus - an OUTPUT drives it, otherwise a device may pull it LOW, or it is pulled up.
+uint8_t hostPinLevel(uint8_t pin) {
+  uint8_t port, mask, device;
+  port = digitalPinToPort(pin);
+  mask = digitalPinToBitMask(pin);
+  if(port >= HOSTPORTS) {
+    return(HIGH);
+  }
+  if(hostDDR[port] & mask) {
+    return((hostPORT[port] & mask) ? HIGH : LOW);
+  }
+  for(device = 0; device < hostNumDevices; device++) {
+    if(hostDevices[device]->pullsLow(pin)) {
+      return(LOW);
+    }
+  }
+  return(HIGH);                                           // The TM1651 modules have pullups on their clock and data lines.
+}
+
+// Let every device see the current pin levels, until the levels settle, e.g. after a device starts an ACK.
+void hostPortsChanged(void) {
+  uint8_t port, pin, device, pass, levels[HOSTPORTS];
+  hostPinAccesses++;
+  for(pass = 0; pass < 4; pass++) {
+    for(device = 0; device < hostNumDevices; device++) {
+      hostDevices[device]->pinsChanged();
+    }
+    for(port = 0; port < HOSTPORTS; port++) {
+      levels[port] = 0x00;
+      for(pin = 0; pin < 8; pin++) {
+        if(hostPinLevel(port * 8 + pin)) {
+          levels[port] |= (1 << pin);
+        }
+      }
+    }
+    if(memcmp((const void*)levels, (const void*)hostPIN, HOSTPORTS) == 0) {
+      break;
+    }
+    for(port = 0; port < HOSTPORTS; port++) {
+      hostPIN[port] = levels[port];
+    }
+  }
+}
+
+// Set a pin to INPUT or OUTPUT - an INPUT has its pullup turned OFF, as on an AVR.
+void pinMode(uint8_t pin, uint8_t mode) {
+  uint8_t port = digitalPinToPort(pin), mask = digitalPinToBitMask(pin);
+  if(port < HOSTPORTS) {
+    if(mode == OUTPUT) {
+      hostDDR[port] |= mask;
+    }
+    else {
+      hostDDR[port] &= ~mask;
+      hostPORT[port] &= ~mask;
+    }
+    hostPortsChanged();
+  }
+}
+
+// Set a pin HIGH or LOW.
+void digitalWrite(uint8_t pin, uint8_t level) {
+  uint8_t port = digitalPinToPort(pin), mask = digitalPinToBitMask(pin);
+  if(port < HOSTPORTS) {
+    if(level == LOW) {
+      hostPORT[port] &= ~mask;
+    }
+    else {
+      hostPORT[port] |= mask;
+    }
+    hostPortsChanged();
+  }
+}
+
+// Read a pin.
+int digitalRead(uint8_t pin) {
+  hostPinAccesses++;
+  return(hostPinLevel(pin));
+}
+
+// Wait for a time in ms - the clock simply moves on.
+void delay(unsigned long time) {
+  hostAdvance(time * 1000UL);
+}
+
+// Wait for a time in us - the clock simply moves on.
+void delayMicroseconds(unsigned int time) {
+  hostAdvance(time);
+}
+
+// Get the time in ms.
+unsigned long millis(void) {
+  return(hostMicros / 1000UL);
+}
+
+// Get the time in us - it wraps at 32 bits, as on an Arduino.
+unsigned long micros(void) {
+  return(hostMicros);
+}
+
+// Move the clock on by a time in us, letting the devices see any change that depends on the time.
+void hostAdvance(uint32_t time) {
+  hostMicros += time;
+  hostPortsChanged();
+}
+
+// Set the clock to a time in us.
+void hostSetMicros(uint32_t time) {
+  hostMicros = time;
+  hostPortsChanged();
+}
+
+// Release all the pins and set the clock back to 0.
+void hostReset(void) {
+  uint8_t port;
+  for(port = 0; port < HOSTPORTS; port++) {
+    hostPORT[port] = 0x00;
+    hostDDR[port] = 0x00;
+  }
+  hostMicros = 0;
+  hostPortsChanged();
+}
+
+// EOF
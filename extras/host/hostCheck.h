@@ -0,0 +1,56 @@
+/*!
+ * The checks for the easiTM1651 host tests - each failed check is reported, and the test fails at the end.
+ *
+ * ****************************
+ * *  Host Check Header       *
+ * ****************************
+*/
+
+#ifndef __HOSTCHECK_H
+  #define __HOSTCHECK_H
+  #include <stdio.h>
+  #include <string>
+
+  static int hostFailures = 0;                            // The number of failed checks.
+
+  // Check a condition.
+  #define CHECK(condition) \
+    do { \
+      if(!(condition)) { \
+        printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+        hostFailures++; \
+      } \
+    } while(0)
+
+  // Check two numbers are equal.
+  #define CHECK_EQ(actual, expected) \
+    do { \
+      long long checkActual = (long long)(actual), checkExpected = (long long)(expected); \
+      if(checkActual != checkExpected) { \
+        printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #actual, #expected, checkActual, checkExpected); \
+        hostFailures++; \
+      } \
+    } while(0)
+
+  // Check two strings are equal.
+  #define CHECK_STR(actual, expected) \
+    do { \
+      std::string checkActual = (actual), checkExpected = (expected); \
+      if(checkActual != checkExpected) { \
+        printf("%s:%d: CHECK_STR(%s) failed:\n  got      %s\n  expected %s\n", __FILE__, __LINE__, #actual, checkActual.c_str(), checkExpected.c_str()); \
+        hostFailures++; \
+      } \
+    } while(0)
+
+  // Report the result of the test. Returns the exit code.
+  static inline int hostResult(const char* name) {
+    if(hostFailures > 0) {
+      printf("%s: %d check(s) failed\n", name, hostFailures);
+      return(1);
+    }
+    printf("%s: passed\n", name);
+    return(0);
+  }
+#endif
+
+// EOF
@@ -0,0 +1,137 @@
+/*!
+ * A host (Linux) stand-in for the Arduino core, just enough to build and test the easiTM1651 library.
+ *
+ * The pins are simulated as AVR style port registers, so the digitalWrite() fallback and the direct port register
+ * fast path (build with -D__AVR__) drive the same pins. Every device attached to the pins, e.g. a TM1651Model,
+ * sees every pin change. The clock is simulated too, it only moves on with delay(), delayMicroseconds() or hostAdvance().
+ *
+ * ****************************
+ * *  Host Arduino Stub File  *
+ * ****************************
+*/
+
+#ifndef __HOST_ARDUINO_H
+  #define __HOST_ARDUINO_H
+  #include <stdint.h>
+  #include <stddef.h>
+  #include <string.h>
+
+  #define HIGH            0x1
+  #define LOW             0x0
+  #define INPUT           0x0
+  #define OUTPUT          0x1
+  #define DEC             10
+  #define HEX             16
+
+  // Flash (PROGMEM) is ordinary memory on the host.
+  #define PROGMEM
+  #define PSTR(text)      (text)
+  #define pgm_read_byte(address) (*(const uint8_t*)(address))
+  #define pgm_read_word(address) (*(const uint16_t*)(address))
+  #define strlen_P        strlen
+  class __FlashStringHelper;
+  #define F(text)         (reinterpret_cast<const __FlashStringHelper*>(PSTR(text)))
+
+  #ifndef F_CPU
+    #define F_CPU         16000000UL
+  #endif
+  #define _BV(bit)        (1 << (bit))
+
+  typedef uint8_t byte;
+  typedef bool boolean;
+
+  void pinMode(uint8_t, uint8_t);
+  void digitalWrite(uint8_t, uint8_t);
+  int digitalRead(uint8_t);
+  void delay(unsigned long);
+  void delayMicroseconds(unsigned int);
+  unsigned long millis(void);
+  unsigned long micros(void);
+  inline void yield(void) {}
+
+  // AVR style port registers, 8 pins per port - D0 - D7 are port 0, D8 - D15 are port 1, and so on.
+  #define HOSTPORTS       4
+  extern volatile uint8_t hostPORT[HOSTPORTS];            // The output latches, or the pullups of the inputs.
+  extern volatile uint8_t hostDDR[HOSTPORTS];             // The pin directions, set for an OUTPUT.
+  extern volatile uint8_t hostPIN[HOSTPORTS];             // The pin levels, as seen on the bus.
+  #define digitalPinToPort(pin)     ((pin) / 8)
+  #define digitalPinToBitMask(pin)  ((uint8_t)(1 << ((pin) % 8)))
+  #define portOutputRegister(port)  (&hostPORT[(port)])
+  #define portModeRegister(port)    (&hostDDR[(port)])
+  #define portInputRegister(port)   (&hostPIN[(port)])
+
+  // Let every device see the current pin levels - called after every pin write, and as the clock moves on.
+  void hostPortsChanged(void);
+
+  // The status register - the fast path restores it at the end of every atomic port access, which lets the devices see the write.
+  struct HostSREG {
+    uint8_t value;
+    operator uint8_t() const { return(value); }
+    HostSREG& operator=(uint8_t newValue) { value = newValue; hostPortsChanged(); return(*this); }
+  };
+  extern HostSREG SREG;
+  inline void cli(void) {}
+  inline void sei(void) {}
+
+  // Something attached to the pins, e.g. a TM1651Model.
+  class HostDevice {
+    public:
+      HostDevice(void);                                   // Attach the device to the pins.
+      virtual ~HostDevice(void);                          // Detach the device from the pins.
+      virtual void pinsChanged(void) = 0;                 // Look at the pin levels, something may have changed.
+      virtual bool pullsLow(uint8_t) = 0;                 // Check if the device is pulling a pin LOW.
+  };
+
+  // Host only functions.
+  extern uint32_t hostPinAccesses;                        // The number of pin accesses - pinMode(), digitalWrite(), digitalRead() or an atomic port access.
+  uint8_t hostPinLevel(uint8_t);                          // Get the level of a pin on the bus - driven, pulled LOW by a device, or pulled up.
+  void hostAdvance(uint32_t);                             // Move the clock on by a time in us.
+  void hostSetMicros(uint32_t);                           // Set the clock to a time in us.
+  void hostReset(void);                                   // Release all the pins and set the clock back to 0.
+
+  class Print {
+    public:
+      virtual ~Print(void) {}
+      virtual size_t write(uint8_t) = 0;
+      virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t count = 0;
+        while(size--) {
+          count += this->write(*buffer++);
+        }
+        return(count);
+      }
+      size_t print(const char* text) { return(this->write((const uint8_t*)text, strlen(text))); }
+      size_t print(const __FlashStringHelper* text) { return(this->print(reinterpret_cast<const char*>(text))); }
+      size_t print(char character) { return(this->write((uint8_t)character)); }
+      size_t print(unsigned char number, int base = DEC) { return(this->print((unsigned long)number, base)); }
+      size_t print(int number, int base = DEC) { return(this->print((long)number, base)); }
+      size_t print(unsigned int number, int base = DEC) { return(this->print((unsigned long)number, base)); }
+      size_t print(long number, int base = DEC) {
+        if(number < 0 && base == DEC) {
+          return(this->print('-') + this->print((unsigned long)-number, base));
+        }
+        return(this->print((unsigned long)number, base));
+      }
+      size_t print(unsigned long number, int base = DEC) {
+        char text[8 * sizeof(long) + 1];
+        char* digit = &text[sizeof(text) - 1];
+        *digit = '\0';
+        do {
+          *--digit = "0123456789ABCDEF"[number % base];
+          number /= base;
+        } while(number);
+        return(this->print(digit));
+      }
+      size_t println(void) { return(this->print('\n')); }
+      template<typename T> size_t println(T value) { return(this->print(value) + this->println()); }
+  };
+
+  class Stream : public Print {
+    public:
+      virtual int available(void) = 0;
+      virtual int read(void) = 0;
+      virtual int peek(void) = 0;
+  };
+#endif
+
+// EOF
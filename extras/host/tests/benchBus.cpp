@@ -0,0 +1,202 @@
+/*!
+ * The bus cost of each display API, in both address modes - the frames, bytes, pin changes, pin accesses and delays,
+ * with the estimated wall time on a target at a given CPU clock.
+ *
+ * The results are written as CSV, one line per API and address mode. Each result is checked against the thresholds
+ * file, and the benchmark fails if any frames, bytes, edges or delay time are over their threshold.
+ *
+ *   benchBus [--fcpu <Hz>] [--pin-cycles <cycles>] [--thresholds <file>] [--csv <file>]
+ *
+ * The estimated wall time is the delay time plus the pin accesses times the CPU cycles of each pin access, e.g. about
+ * 56 for digitalWrite() on an AVR, or about 6 for the port register fast path.
+ */
+
+#include "easiTM1651.h"
+#include "tm1651Model.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#define BENCHCLK51      2                                 // The clock pin of the benchmark module.
+#define BENCHDIO51      3                                 // The data pin of the benchmark module.
+
+// The result of one API run.
+struct BenchResult {
+  std::string mode;                                       // The address mode, "auto" or "fixed".
+  std::string api;                                        // The API, e.g. "int12".
+  uint8_t digits;                                         // The number of digits of the module.
+  uint32_t frames;
+  uint32_t bytes;
+  uint32_t edges;
+  uint32_t accesses;                                      // The pin accesses, pinMode(), digitalWrite(), digitalRead() or an atomic port access.
+  uint32_t delays;
+  uint32_t delayTime;                                     // The time spent in the delays in us.
+  double estimate;                                        // The estimated wall time on the target in us.
+};
+
+// The benchmark settings.
+static uint32_t benchFcpu = F_CPU;
+static uint32_t benchPinCycles = 56;
+static std::vector<BenchResult> benchResults;
+
+// An API run - the setup is not measured, the action is.
+typedef void (*BenchStep)(TM1651&);
+
+// Run an API on a fresh module, after its setup, and record the bus cost of the action.
+static void benchRun(bool addrAuto, bool isLEDC68, uint8_t digits, const char* api, BenchStep setup, BenchStep action) {
+  BenchResult result;
+  uint32_t accesses, start;
+  hostReset();
+  TM1651 display(BENCHCLK51, BENCHDIO51, isLEDC68, addrAuto);
+  TM1651Model model(BENCHCLK51, BENCHDIO51);
+  if(setup) {
+    setup(display);
+  }
+  display.resetStats();
+  model.clearLogs();
+  accesses = hostPinAccesses;
+  start = micros();
+  action(display);
+  result.mode = addrAuto ? "auto" : "fixed";
+  result.api = api;
+  result.digits = digits;
+  result.frames = display.getStats().frames;
+  result.bytes = display.getStats().bytes;
+  result.edges = display.getStats().edges;
+  result.accesses = hostPinAccesses - accesses;
+  result.delays = display.getStats().delays;
+  result.delayTime = micros() - start;
+  result.estimate = result.delayTime + (double)result.accesses * benchPinCycles * 1000000.0 / benchFcpu;
+  if(model.frames != result.frames || model.nacks != 0) {
+    printf("benchBus: %s/%s: the model saw %u frames and %u NACKs\n", result.mode.c_str(), api, (unsigned)model.frames, (unsigned)model.nacks);
+    exit(1);
+  }
+  benchResults.push_back(result);
+}
+
+static void beginLEDC68(TM1651& display) { display.begin(3, 2); }
+static void begin4(TM1651& display) { display.begin(4, 2); }
+static void show888(TM1651& display) { display.begin(3, 2); display.displayInt12(0, 888); display.displayDP(ON); }
+static void runClear(TM1651& display) { display.displayClear(); }
+static void runChar(TM1651& display) { display.displayChar(0, 5); }
+static void runInt8(TM1651& display) { display.displayInt8(0, 42); }
+static void runInt12(TM1651& display) { display.displayInt12(0, 123); }
+static void runInt16(TM1651& display) { display.displayInt16(0, 1234); }
+static void runDP(TM1651& display) { display.displayDP(ON); }
+static void runTest(TM1651& display) { display.displayTest(true); display.displayTest(false); }
+static void runBrightness(TM1651& display) { display.displayBrightness(5); }
+
+// Run every API in an address mode - an LEDC68 module, apart from displayInt16() on a 4-digit module.
+static void benchMode(bool addrAuto) {
+  benchRun(addrAuto, true, 3, "begin", NULL, beginLEDC68);
+  benchRun(addrAuto, true, 3, "clear", show888, runClear);
+  benchRun(addrAuto, true, 3, "char", beginLEDC68, runChar);
+  benchRun(addrAuto, true, 3, "int8", beginLEDC68, runInt8);
+  benchRun(addrAuto, true, 3, "int12", beginLEDC68, runInt12);
+  benchRun(addrAuto, false, 4, "int16", begin4, runInt16);
+  benchRun(addrAuto, true, 3, "dp", beginLEDC68, runDP);
+  benchRun(addrAuto, true, 3, "test", beginLEDC68, runTest);
+  benchRun(addrAuto, true, 3, "brightness", beginLEDC68, runBrightness);
+}
+
+// Write the results as CSV.
+static void benchWrite(FILE* file) {
+  size_t index;
+  fprintf(file, "mode,api,digits,frames,bytes,edges,accesses,delays,delay_us,est_us,f_cpu,pin_cycles\n");
+  for(index = 0; index < benchResults.size(); index++) {
+    const BenchResult& result = benchResults[index];
+    fprintf(file, "%s,%s,%u,%u,%u,%u,%u,%u,%u,%.1f,%u,%u\n", result.mode.c_str(), result.api.c_str(), result.digits,
+            (unsigned)result.frames, (unsigned)result.bytes, (unsigned)result.edges, (unsigned)result.accesses,
+            (unsigned)result.delays, (unsigned)result.delayTime, result.estimate, (unsigned)benchFcpu, (unsigned)benchPinCycles);
+  }
+}
+
+// Check the results against the thresholds file - lines of mode,api,frames,bytes,edges,delay_us, and # comments.
+// Returns the number of results over their threshold, or that have no threshold.
+static int benchCheck(const char* path) {
+  FILE* file = fopen(path, "r");
+  char line[128], mode[16], api[16];
+  unsigned frames, bytes, edges, delayTime;
+  size_t index;
+  int failures = 0;
+  std::vector<bool> checked(benchResults.size(), false);
+  if(!file) {
+    printf("benchBus: cannot open %s\n", path);
+    return(1);
+  }
+  while(fgets(line, sizeof(line), file)) {
+    if(line[0] == '#' || sscanf(line, "%15[^,],%15[^,],%u,%u,%u,%u", mode, api, &frames, &bytes, &edges, &delayTime) != 6) {
+      continue;
+    }
+    for(index = 0; index < benchResults.size(); index++) {
+      const BenchResult& result = benchResults[index];
+      if(result.mode == mode && result.api == api) {
+        checked[index] = true;
+        if(result.frames > frames || result.bytes > bytes || result.edges > edges || result.delayTime > delayTime) {
+          printf("benchBus: %s/%s over its threshold: %u frames, %u bytes, %u edges, %u us (max %u, %u, %u, %u us)\n",
+                 mode, api, (unsigned)result.frames, (unsigned)result.bytes, (unsigned)result.edges, (unsigned)result.delayTime,
+                 frames, bytes, edges, delayTime);
+          failures++;
+        }
+      }
+    }
+  }
+  fclose(file);
+  for(index = 0; index < benchResults.size(); index++) {
+    if(!checked[index]) {
+      printf("benchBus: %s/%s has no threshold\n", benchResults[index].mode.c_str(), benchResults[index].api.c_str());
+      failures++;
+    }
+  }
+  return(failures);
+}
+
+int main(int argc, char** argv) {
+  const char* thresholds = NULL;
+  const char* csv = NULL;
+  FILE* file;
+  int arg, failures = 0;
+  for(arg = 1; arg + 1 < argc; arg += 2) {
+    std::string option = argv[arg];
+    if(option == "--fcpu") {
+      benchFcpu = strtoul(argv[arg + 1], NULL, 10);
+    }
+    else if(option == "--pin-cycles") {
+      benchPinCycles = strtoul(argv[arg + 1], NULL, 10);
+    }
+    else if(option == "--thresholds") {
+      thresholds = argv[arg + 1];
+    }
+    else if(option == "--csv") {
+      csv = argv[arg + 1];
+    }
+  }
+  if(arg != argc || benchFcpu == 0) {
+    printf("usage: benchBus [--fcpu <Hz>] [--pin-cycles <cycles>] [--thresholds <file>] [--csv <file>]\n");
+    return(2);
+  }
+  benchMode(true);
+  benchMode(false);
+  benchWrite(stdout);
+  if(csv) {
+    file = fopen(csv, "w");
+    if(!file) {
+      printf("benchBus: cannot write %s\n", csv);
+      return(1);
+    }
+    benchWrite(file);
+    fclose(file);
+  }
+  if(thresholds) {
+    failures = benchCheck(thresholds);
+  }
+  if(failures > 0) {
+    printf("benchBus: %d result(s) failed\n", failures);
+    return(1);
+  }
+  printf("benchBus: passed\n");
+  return(0);
+}
+
+// EOF
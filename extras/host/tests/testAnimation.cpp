@@ -0,0 +1,96 @@
+/*!
+ * The animation player - the frame width of the built in 3-digit animations on a 4-digit display, wider frames on a
+ * narrower display, and the marquee.
+ */
+
+#include "easiTM1651.h"
+#include "tm1651Model.h"
+#include "hostCheck.h"
+
+#define ANIMINTERVAL51  100                               // The time between frames in ms.
+
+// Move the clock on to the next frame, and show it.
+static void nextFrame(TM1651Animation& animation) {
+  hostAdvance(ANIMINTERVAL51 * 1000UL);
+  animation.tick(millis());
+}
+
+// The built in 3-digit frames on a 4-digit display - the stride is the frame width, and the 4th digit stays blank.
+static void testBuiltIn(void) {
+  TM1651 display(2, 3, false, true);
+  TM1651Model model(2, 3);
+  TM1651Animation animation(display);
+  uint8_t frame, digit;
+  display.begin(4, 2);
+  display.displayChar(3, 8);
+  animation.playFrames(tmAnimCircle51, ANIMCIRCLE51, ANIMINTERVAL51, false);
+  animation.tick(millis());                               // The first frame is timed from here.
+  for(frame = 0; frame < ANIMCIRCLE51; frame++) {
+    for(digit = 0; digit < ANIMWIDTH51; digit++) {
+      CHECK_EQ(model.ram[digit], tmAnimCircle51[frame * ANIMWIDTH51 + digit]);
+    }
+    CHECK_EQ(model.ram[3], 0x00);
+    nextFrame(animation);
+  }
+  CHECK(!animation.playing());
+}
+
+// 4-digit frames on a 4-digit display, and on a 3-digit display, where the 4th code of each frame is skipped.
+static void testWidth(void) {
+  static const uint8_t frames[] PROGMEM = {0x01, 0x02, 0x04, 0x08,
+                                           0x10, 0x20, 0x40, 0x3f};
+  TM1651 display4(2, 3, false, true), display3(4, 5, false, true);
+  TM1651Model model4(2, 3), model3(4, 5);
+  TM1651Animation animation4(display4), animation3(display3);
+  display4.begin(4, 2);
+  display3.begin(3, 2);
+  animation4.playFrames(frames, 2, ANIMINTERVAL51, true, 4);
+  animation3.playFrames(frames, 2, ANIMINTERVAL51, true, 4);
+  CHECK_EQ(model4.ram[3], 0x08);
+  CHECK_EQ(model3.ram[2], 0x04);
+  animation4.tick(millis());
+  animation3.tick(millis());
+  nextFrame(animation4);
+  nextFrame(animation3);
+  CHECK_EQ(model4.ram[0], 0x10);
+  CHECK_EQ(model4.ram[3], 0x3f);
+  CHECK_EQ(model3.ram[0], 0x10);
+  CHECK_EQ(model3.ram[2], 0x40);
+  CHECK_EQ(model3.ram[3], 0x00);
+  nextFrame(animation4);
+  CHECK_EQ(model4.ram[0], 0x01);                          // It repeats.
+  CHECK(animation4.playing());
+  animation4.playFrames(frames, 2, ANIMINTERVAL51, true, 0);
+  CHECK_EQ(model4.ram[0], 0x01);                          // A frame width of 0 is ignored.
+}
+
+// A marquee scrolls in from the right, and out to the left.
+static void testMarquee(void) {
+  TM1651 display(2, 3, false, true);
+  TM1651Model model(2, 3);
+  TM1651Animation animation(display);
+  display.begin(3, 2);
+  animation.playMarquee("Hi", ANIMINTERVAL51, false);
+  CHECK_EQ(model.ram[2], tmAscii51('H'));
+  animation.tick(millis());
+  nextFrame(animation);
+  CHECK_EQ(model.ram[1], tmAscii51('H'));
+  CHECK_EQ(model.ram[2], tmAscii51('i'));
+  nextFrame(animation);
+  nextFrame(animation);
+  CHECK_EQ(model.ram[0], tmAscii51('i'));
+  CHECK_EQ(model.ram[1], 0x00);
+  nextFrame(animation);
+  CHECK_EQ(model.ram[0], 0x00);
+  nextFrame(animation);
+  CHECK(!animation.playing());
+}
+
+int main(void) {
+  testBuiltIn();
+  testWidth();
+  testMarquee();
+  return(hostResult("testAnimation"));
+}
+
+// EOF
@@ -0,0 +1,87 @@
+/*!
+ * A TM1651Array of modules sharing a clock pin - the parallel frames, the retries and statistics, and the rewrite of a
+ * module that did not ACK.
+ */
+
+#include "easiTM1651.h"
+#include "tm1651Model.h"
+#include "hostCheck.h"
+
+#define ARRAYCLK51      2                                 // The shared clock pin, the data pins are 3, 4 and 5.
+
+// Check the display RAM of a model matches the registers recorded by its module.
+static void checkModule(TM1651& display, TM1651Model& model) {
+  uint8_t digit;
+  for(digit = 0; digit < MAX_DIGITS51; digit++) {
+    CHECK_EQ(model.ram[digit], display.readRegister(digit));
+  }
+  CHECK_EQ(model.control, display.cmdDispCtrl);
+}
+
+static void testArray(bool addrAuto) {
+  TM1651 displays[] = {TM1651(ARRAYCLK51, 3, true, addrAuto), TM1651(ARRAYCLK51, 4, true, addrAuto), TM1651(ARRAYCLK51, 5, true, addrAuto)};
+  TM1651Model model0(ARRAYCLK51, 3), model1(ARRAYCLK51, 4), model2(ARRAYCLK51, 5);
+  TM1651Model* models[] = {&model0, &model1, &model2};
+  TM1651Array array(displays, 3);
+  uint8_t module;
+  array.begin(3, 2);
+  for(module = 0; module < 3; module++) {
+    CHECK_EQ(models[module]->control, DISP_ON51 + 2);
+    CHECK_EQ(models[module]->autoMode, addrAuto);
+    displays[module].displayInt12(0, 100 + module);
+    displays[module].resetStats();
+    models[module]->clearLogs();
+  }
+  CHECK_EQ(array.commit(), 0x00);
+  for(module = 0; module < 3; module++) {
+    checkModule(displays[module], *models[module]);
+    CHECK_EQ(models[module]->frames, addrAuto ? 1 : 3);  // Every module sees every frame.
+    CHECK_EQ(displays[module].getStats().frames, addrAuto ? 1 : 3);
+  }
+  CHECK_EQ(displays[1].getStats().bytes, addrAuto ? 4 : 6);
+  // A byte that is not acknowledged - the frame is sent again to every module, and the retry is counted.
+  model1.nackBytes = 1;
+  displays[1].displayChar(2, 7);
+  CHECK_EQ(array.commit(), 0x00);
+  CHECK_EQ(displays[1].getStats().nacks, 1);
+  CHECK_EQ(displays[1].getStats().retries, 1);
+  CHECK_EQ(displays[0].getStats().nacks, 0);
+  checkModule(displays[1], model1);
+  // A module that does not ACK at all keeps its changes, and is rewritten in full once it is back.
+  model1.nackAll = true;
+  displays[0].displayChar(0, 9);
+  displays[1].displayChar(0, 9);
+  displays[1].displayDP(ON);
+  CHECK_EQ(array.commit(), 0x02);
+  checkModule(displays[0], model0);
+  CHECK(model1.ram[0] != displays[1].readRegister(0));
+  model1.nackAll = false;
+  model1.control = 0x00;                                  // As a module that lost power.
+  model1.autoMode = !addrAuto;
+  memset(model1.ram, 0x00, sizeof(model1.ram));
+  CHECK_EQ(array.commit(), 0x00);                         // Nothing else has changed, but module 1 must be rewritten.
+  checkModule(displays[1], model1);
+  CHECK_EQ(model1.autoMode, addrAuto);
+  CHECK_EQ(displays[1].getStats().resyncs, 1);
+  model1.clearLogs();
+  CHECK_EQ(array.commit(), 0x00);
+  CHECK_EQ(model1.frames, 0);                             // And only once.
+  // A display control command that fails is sent again by the next commit().
+  model2.nackAll = true;
+  array.displayBrightness(5);
+  model2.nackAll = false;
+  CHECK_EQ(model2.control, DISP_ON51 + 2);
+  displays[0].displayChar(1, 3);
+  CHECK_EQ(array.commit(), 0x00);
+  CHECK_EQ(model2.control, DISP_ON51 + 5);
+  checkModule(displays[2], model2);
+  checkModule(displays[0], model0);
+}
+
+int main(void) {
+  testArray(true);
+  testArray(false);
+  return(hostResult("testArray"));
+}
+
+// EOF
@@ -0,0 +1,85 @@
+/*!
+ * The clock and data edge order of the bus, for comparing the digitalWrite() fallback with the port register fast path,
+ * and the asynchronous state machine with the synchronous bit banging.
+ *
+ * Built once as is, once with __AVR__ defined, and once with USEASYNCMODE51 defined, each build runs the same display
+ * calls, checks the frames, and writes the edge log of each call to the file given. The files must be the same, edge
+ * for edge. The asynchronous build is stepped one service() call at a time, with the clock moving on between steps.
+ *
+ *   testEdges <file>
+ */
+
+#include "easiTM1651.h"
+#include "tm1651Model.h"
+#include "hostCheck.h"
+
+static FILE* edgeFile;
+
+// Send any queued frames, one step at a time - the synchronous build has already sent them.
+static void settle(TM1651& display) {
+  while(display.busy()) {
+    hostAdvance(DEF_ACKWAIT51);
+    display.service();
+  }
+}
+
+// Write the edge log of a call, and clear the logs for the next one.
+static void logEdges(const char* name, TM1651Model& model) {
+  fprintf(edgeFile, "%s: %s\n", name, model.edges.c_str());
+  model.clearLogs();
+}
+
+// Both address modes, with the idle bus, a held update and a byte that is not acknowledged.
+static void runCalls(bool addrAuto) {
+  TM1651 display(2, 3, true, addrAuto);
+  TM1651Model model(2, 3);
+  model.logEdges = true;
+  display.begin(3, 2);
+  settle(display);
+  CHECK_STR(model.frameText(), addrAuto ? "[40] [c0 00 00 00 00] [8a]" : "[44] [c0 00] [c1 00] [c2 00] [c3 00] [8a]");
+  logEdges("begin", model);
+  display.displayInt12(0, 123);
+  #ifdef USEASYNCMODE51
+    CHECK(display.busy() && model.frames == 0);                 // Only queued, nothing is sent until service().
+  #endif
+  settle(display);
+  CHECK_EQ(model.frames, addrAuto ? 1 : 3);
+  logEdges("int12", model);
+  display.displayDP(ON);
+  settle(display);
+  CHECK_STR(model.frameText(), "[c3 08]");
+  logEdges("dp", model);
+  display.beginUpdate();
+  display.displayChar(0, 8);
+  display.displayChar(2, 8);
+  display.commit();
+  settle(display);
+  logEdges("commit", model);
+  model.nackBytes = 1;
+  display.displayChar(1, 0);
+  settle(display);
+  CHECK_EQ(model.nacks, 1);
+  CHECK_EQ(model.ram[1], TM1651::charCode(0));
+  logEdges("nack", model);
+  display.displayBrightness(7);
+  settle(display);
+  CHECK_STR(model.frameText(), "[8f]");
+  logEdges("brightness", model);
+  display.displayOff();
+  settle(display);
+  logEdges("off", model);
+  CHECK(hostPinLevel(2) == HIGH && hostPinLevel(3) == HIGH);  // The bus is left idle.
+}
+
+int main(int argc, char** argv) {
+  if(argc != 2 || !(edgeFile = fopen(argv[1], "w"))) {
+    printf("usage: testEdges <file>\n");
+    return(2);
+  }
+  runCalls(true);
+  runCalls(false);
+  fclose(edgeFile);
+  return(hostResult(argv[0]));
+}
+
+// EOF
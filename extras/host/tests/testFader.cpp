@@ -0,0 +1,131 @@
+/*!
+ * The brightness fader - the dithering duty cycle of every fade level, the rate limit and the command stream of the
+ * fades.
+ */
+
+#include "easiTM1651.h"
+#include "tm1651Model.h"
+#include "hostCheck.h"
+
+#define FADESLOTS51     (FADE_STEPS51 * 4)                // The brightness command slots to average the duty cycle over.
+
+// Move the clock on by a time in ms, and update the fader.
+static void tickAfter(TM1651Fader& fader, uint32_t time) {
+  hostAdvance(time * 1000UL);
+  fader.tick(millis());
+}
+
+// Every fade level is dithered between the two nearest hardware levels, and averages out to the fade level exactly.
+static void testDutyCycle(void) {
+  TM1651 display(2, 3, true, true);
+  TM1651Model model(2, 3);
+  TM1651Fader fader(display);
+  uint16_t level, slot, total, commands, changes;
+  uint8_t lastControl;
+  display.begin(3, 2);
+  for(level = 0; level <= FADE_MAX51; level++) {
+    fader.setLevel(level);
+    tickAfter(fader, FADE_RATE51);                        // Settle the dithering error for the new level.
+    model.clearLogs();
+    total = 0;
+    changes = 0;
+    lastControl = model.control;
+    for(slot = 0; slot < FADESLOTS51; slot++) {
+      tickAfter(fader, FADE_RATE51);
+      CHECK(model.control == DISP_ON51 + level / FADE_STEPS51 || model.control == DISP_ON51 + level / FADE_STEPS51 + 1);
+      total += model.control - DISP_ON51;
+      if(model.control != lastControl) {
+        changes++;
+        lastControl = model.control;
+      }
+    }
+    CHECK_EQ(total, level * FADESLOTS51 / FADE_STEPS51); // The average hardware level is the fade level.
+    commands = model.frames;
+    CHECK_EQ(commands, changes);                          // A command is only sent when the hardware level changes.
+    if(level % FADE_STEPS51 == 0) {
+      CHECK_EQ(commands, 0);                              // An exact hardware level is never dithered.
+    }
+  }
+  CHECK_EQ(model.nacks, 0);
+}
+
+// No more than one brightness command per rate period, however often tick() is called.
+static void testRate(void) {
+  TM1651 display(2, 3, true, true);
+  TM1651Model model(2, 3);
+  TM1651Fader fader(display);
+  uint16_t tick;
+  display.begin(3, 2);
+  fader.setRate(10);
+  fader.setLevel(FADE_STEPS51 * 3 + FADE_STEPS51 / 2); // 50% dithering, the most commands.
+  model.clearLogs();
+  for(tick = 0; tick < 1000; tick++) {
+    tickAfter(fader, 1);
+  }
+  CHECK(model.frames >= 100 && model.frames <= 101);     // One slot every 10 ms, and one straight away.
+}
+
+// A fade out ends with the display OFF, a fade in turns it back ON, and every command in between is a brightness command.
+static void testFades(void) {
+  TM1651 display(2, 3, true, true);
+  TM1651Model model(2, 3);
+  TM1651Fader fader(display);
+  size_t frame;
+  uint16_t time;
+  display.begin(3, 7);
+  fader.setLevel(FADE_MAX51);
+  tickAfter(fader, FADE_RATE51);
+  model.clearLogs();
+  fader.fadeOut(200);
+  for(time = 0; time < 300 && fader.fading(); time += FADE_RATE51) {
+    tickAfter(fader, FADE_RATE51);
+  }
+  tickAfter(fader, FADE_RATE51);
+  CHECK(!fader.fading());
+  CHECK_EQ(model.control, DISP_OFF51);
+  CHECK(model.frames > INTENSITY_MAX51);
+  for(frame = 0; frame + 1 < model.frameLog.size(); frame++) {
+    CHECK(model.frameLog[frame].size() == 1 && (model.frameLog[frame][0] & 0xf8) == DISP_ON51);
+  }
+  CHECK_EQ(model.frameLog.back()[0], DISP_OFF51);
+  model.clearLogs();
+  tickAfter(fader, 100);
+  CHECK_EQ(model.frames, 0);                              // The fader leaves the display alone once it is OFF.
+  fader.fadeIn(FADE_MAX51, 100);
+  tickAfter(fader, FADE_RATE51);
+  CHECK_EQ(model.control, DISP_ON51);                     // ON at the dimmest.
+  for(time = 0; time < 200; time += FADE_RATE51) {
+    tickAfter(fader, FADE_RATE51);
+  }
+  CHECK_EQ(model.control, DISP_ON51 + INTENSITY_MAX51);
+}
+
+// A fade is timed only by the times given to tick(), even on a clock that is not millis().
+static void testClock(void) {
+  TM1651 display(2, 3, true, true);
+  TM1651Model model(2, 3);
+  TM1651Fader fader(display);
+  uint32_t timeNow = 0xffffff00UL;                        // A clock that wraps during the fade.
+  display.begin(3, 2);
+  fader.setLevel(0);
+  fader.tick(timeNow);
+  fader.fadeTo(FADE_MAX51, 100);
+  fader.tick(timeNow += FADE_RATE51);
+  CHECK_EQ(model.control, DISP_ON51);                     // The fade starts at the first tick().
+  fader.tick(timeNow += 50);
+  CHECK(model.control > DISP_ON51 && model.control < DISP_ON51 + INTENSITY_MAX51);
+  CHECK(fader.fading());
+  fader.tick(timeNow += 52);
+  CHECK(!fader.fading());
+  CHECK_EQ(model.control, DISP_ON51 + INTENSITY_MAX51);
+}
+
+int main(void) {
+  testDutyCycle();
+  testRate();
+  testFades();
+  testClock();
+  return(hostResult("testFader"));
+}
+
+// EOF
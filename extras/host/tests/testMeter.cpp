@@ -0,0 +1,137 @@
+/*!
+ * The level meter - an instant rise, the decay rate, the peak hold and its fall, the digits written, and a redraw.
+ */
+
+#include "easiTM1651.h"
+#include "tm1651Model.h"
+#include "hostCheck.h"
+
+// A layout of 8 steps across 2 digits, segments a - d of digit 0, then segments a - d of digit 1.
+static const uint8_t meterLayout[] PROGMEM = {tmMeterStep51(0, 'a'), tmMeterStep51(0, 'b'), tmMeterStep51(0, 'c'), tmMeterStep51(0, 'd'),
+                                              tmMeterStep51(1, 'a'), tmMeterStep51(1, 'b'), tmMeterStep51(1, 'c'), tmMeterStep51(1, 'd')};
+
+// Move the clock on by a time in ms, and update the meter.
+static void tickAfter(TM1651Meter& meter, uint32_t time) {
+  hostAdvance(time * 1000UL);
+  meter.tick(millis());
+}
+
+// The level rises straight away, and falls one step per decay period, catching up any missed steps.
+static void testDecay(void) {
+  TM1651 display(2, 3, true, true);
+  TM1651Model model(2, 3);
+  TM1651Meter meter(display, tmMeterBattery51, METERBATTERY51);
+  display.begin(3, 2);
+  meter.setDecay(100);
+  tickAfter(meter, 1000);
+  model.clearLogs();
+  meter.setLevel(5);
+  CHECK_STR(model.frameText(), "[c0 1f]");                // Segments a - e, at once.
+  meter.setLevel(1);
+  CHECK_EQ(model.ram[0], 0x1f);
+  tickAfter(meter, 99);                                   // The fall is timed from the next tick().
+  CHECK_EQ(model.ram[0], 0x1f);
+  tickAfter(meter, 99);
+  CHECK_EQ(model.ram[0], 0x1f);
+  tickAfter(meter, 1);
+  CHECK_EQ(model.ram[0], 0x0f);
+  tickAfter(meter, 250);                                  // 2 more steps.
+  CHECK_EQ(model.ram[0], 0x03);
+  tickAfter(meter, 50);
+  CHECK_EQ(model.ram[0], 0x01);
+  model.clearLogs();
+  tickAfter(meter, 1000);                                 // The level has reached its target.
+  CHECK_EQ(model.ram[0], 0x01);
+  CHECK_EQ(model.frames, 0);
+  meter.setLevel(METERBATTERY51 + 3);                     // Clipped to the last step.
+  CHECK_EQ(model.ram[0], 0x7f);
+  // With no decay the level falls straight away.
+  meter.setDecay(0);
+  meter.setLevel(2);
+  CHECK_EQ(model.ram[0], 0x03);
+}
+
+// The peak is held for the hold time, then falls at the decay rate, never below the level.
+static void testPeak(void) {
+  TM1651 display(2, 3, true, true);
+  TM1651Model model(2, 3);
+  TM1651Meter meter(display, tmMeterBattery51, METERBATTERY51);
+  display.begin(3, 2);
+  meter.setDecay(100);
+  meter.setPeakHold(500);
+  tickAfter(meter, 1000);
+  meter.setLevel(6);
+  CHECK_EQ(model.ram[0], 0x3f);
+  meter.setLevel(0);
+  tickAfter(meter, 0);
+  tickAfter(meter, 300);                                  // The level is 3, the peak is held at step 6.
+  CHECK_EQ(model.ram[0], 0x27);
+  tickAfter(meter, 199);
+  CHECK_EQ(model.ram[0], 0x23);
+  tickAfter(meter, 1);                                    // The hold is over, the peak falls a step, the level is 1.
+  CHECK_EQ(model.ram[0], 0x11);
+  tickAfter(meter, 100);
+  CHECK_EQ(model.ram[0], 0x08);                           // The level is 0, the peak is at step 4.
+  tickAfter(meter, 400);
+  CHECK_EQ(model.ram[0], 0x00);
+  // A peak hold of 0 turns the peak OFF straight away.
+  meter.setLevel(4);
+  meter.setLevel(0);
+  tickAfter(meter, 0);
+  tickAfter(meter, 400);
+  CHECK_EQ(model.ram[0], 0x08);
+  meter.setPeakHold(0);
+  CHECK_EQ(model.ram[0], 0x00);
+}
+
+// Only the digits with a changed step are written, and the other segments of a digit are left alone.
+static void testDigits(void) {
+  TM1651 display(2, 3, false, false);
+  TM1651Model model(2, 3);
+  TM1651Meter meter(display, meterLayout, sizeof(meterLayout));
+  display.begin(4, 2);
+  display.displayChar(1, 0x40, true);                     // Segment g of digit 1 is not part of the meter.
+  display.displayChar(3, 7);
+  tickAfter(meter, 1000);
+  model.clearLogs();
+  meter.setLevel(2);
+  CHECK_STR(model.frameText(), "[c0 03]");
+  model.clearLogs();
+  meter.setLevel(6);
+  CHECK_STR(model.frameText(), "[c0 0f] [c1 43]");
+  model.clearLogs();
+  meter.setLevel(7);
+  CHECK_STR(model.frameText(), "[c1 47]");
+  model.clearLogs();
+  meter.setLevel(7);
+  CHECK_EQ(model.frames, 0);
+  CHECK_EQ(model.ram[3], TM1651::charCode(7));
+}
+
+// A redraw writes every step again, e.g. after the display has been cleared.
+static void testRedraw(void) {
+  TM1651 display(2, 3, false, true);
+  TM1651Model model(2, 3);
+  TM1651Meter meter(display, meterLayout, sizeof(meterLayout));
+  display.begin(4, 2);
+  tickAfter(meter, 1000);
+  meter.setLevel(5);
+  display.displayClear();
+  CHECK_EQ(model.ram[0], 0x00);
+  model.clearLogs();
+  meter.redraw();
+  CHECK_STR(model.frameText(), "[c0 0f 01]");
+  model.clearLogs();
+  meter.redraw();
+  CHECK_EQ(model.frames, 0);                              // Nothing has changed.
+}
+
+int main(void) {
+  testDecay();
+  testPeak();
+  testDigits();
+  testRedraw();
+  return(hostResult("testMeter"));
+}
+
+// EOF
@@ -0,0 +1,275 @@
+/*!
+ * The division free number conversion - every decimal and hex number of displayInt8(), displayInt12() and
+ * displayInt16() against a reference conversion with / and %, displayIncrement() counting through them all, the
+ * formats, overflow, decimal point and memo of displayNumber(), and a micro-benchmark of the conversion against the
+ * reference.
+ */
+
+#include "easiTM1651.h"
+#include "tm1651Model.h"
+#include "hostCheck.h"
+#include <chrono>
+
+// The reference conversion, as the library did it before - one / and one % per digit. Returns the number of mismatched digits.
+static uint32_t checkDigits(TM1651& display, uint8_t numDigits, uint16_t number, uint8_t base) {
+  uint32_t mismatches = 0;
+  uint8_t digit = numDigits;
+  while(digit-- > 0) {
+    if(display.readRegister(digit) != TM1651::charCode(number % base)) {
+      mismatches++;
+    }
+    number /= base;
+  }
+  return(mismatches);
+}
+
+// Check the display shows a text, one character per digit - 0 - 9 and a - f, a space for a blank, '-' for a mDash, '^'
+// for a uDash and '_' for a lDash.
+static bool shows(const TM1651Model& model, const char* text) {
+  uint8_t digit, code;
+  for(digit = 0; text[digit] != '\0'; digit++) {
+    switch(text[digit]) {
+      case ' ': code = 0x00; break;
+      case '-': code = TM1651::charCode(34); break;
+      case '^': code = TM1651::charCode(33); break;
+      case '_': code = TM1651::charCode(35); break;
+      default: code = TM1651::charCode((text[digit] <= '9') ? text[digit] - '0' : text[digit] - 'a' + 10); break;
+    }
+    if(model.ram[digit] != code) {
+      return(false);
+    }
+  }
+  return(true);
+}
+
+// Every number of each size, in decimal and hex, with the clipping of the decimal numbers - the writes are held back
+// until the end, as only the conversion is being checked.
+static void testExhaustive(void) {
+  TM1651 display(2, 3, false, true);
+  TM1651Model model(2, 3);
+  uint32_t number, mismatches = 0;
+  display.begin(4, 2);
+  display.beginUpdate();
+  for(number = 0; number <= 0xff; number++) {
+    display.displayInt8(0, number, true);
+    mismatches += checkDigits(display, 2, (number > 99) ? 99 : number, 10);
+    display.displayInt8(0, number, false);
+    mismatches += checkDigits(display, 2, number, 16);
+  }
+  for(number = 0; number <= 0xfff; number++) {
+    display.displayInt12(0, number, true);
+    mismatches += checkDigits(display, 3, (number > 999) ? 999 : number, 10);
+    display.displayInt12(0, number, false);
+    mismatches += checkDigits(display, 3, number, 16);
+  }
+  for(number = 0; number <= 0xffff; number++) {
+    if(number <= 9999) {
+      display.displayInt16(0, number, true);
+      mismatches += checkDigits(display, 4, number, 10);
+    }
+    display.displayInt16(0, number, false);
+    mismatches += checkDigits(display, 4, number, 16);
+  }
+  display.displayInt16(0, 12345, true);
+  mismatches += checkDigits(display, 4, 9999, 10);        // Clipped.
+  display.commit();
+  CHECK_EQ(mismatches, 0);
+  CHECK_EQ(model.nacks, 0);
+  CHECK_EQ(model.ram[0], TM1651::charCode(9));            // The display matches the last number sent.
+  CHECK_EQ(model.ram[3], TM1651::charCode(9));
+}
+
+// displayIncrement() counts through every decimal number, and rolls over to 0.
+static void testIncrement(void) {
+  TM1651 display(2, 3, false, true);
+  TM1651Model model(2, 3);
+  uint32_t number, mismatches = 0;
+  display.begin(4, 2);
+  display.displayInt16(0, 0, true);
+  display.beginUpdate();
+  for(number = 1; number <= 10000; number++) {
+    display.displayIncrement(0, 4, true);
+    mismatches += checkDigits(display, 4, number % 10000, 10);
+  }
+  display.commit();
+  CHECK_EQ(mismatches, 0);
+  CHECK_EQ(model.ram[3], TM1651::charCode(0));
+  // Only the digits that roll over are written.
+  display.displayInt16(0, 1238, true);
+  model.clearLogs();
+  display.displayIncrement(0, 4, true);
+  CHECK_STR(model.frameText(), "[c3 67]");
+  model.clearLogs();
+  display.displayIncrement(0, 4, true);
+  CHECK_STR(model.frameText(), "[c2 66 3f]");
+}
+
+// The formats of displayNumber() - right or left aligned, the leading zeros blanked or kept, fixed point and hex.
+static void testFormats(void) {
+  TM1651 display(2, 3, false, true);
+  TM1651Model model(2, 3);
+  display.begin(4, 2);
+  display.displayNumber(0, 4, 42);
+  CHECK(shows(model, "  42"));
+  display.displayNumber(0, 4, -42);
+  CHECK(shows(model, " -42"));
+  display.displayNumber(0, 4, 0);
+  CHECK(shows(model, "   0"));
+  display.displayNumber(0, 4, 42, 0, NUM_ZEROS51);
+  CHECK(shows(model, "0042"));
+  display.displayNumber(0, 4, -42, 0, NUM_ZEROS51);
+  CHECK(shows(model, "-042"));
+  display.displayNumber(0, 4, -42, 0, NUM_LEFT51);
+  CHECK(shows(model, "-42 "));
+  display.displayNumber(0, 4, 7, 0, NUM_LEFT51);
+  CHECK(shows(model, "7   "));
+  display.displayNumber(0, 4, 25, 2);                     // 0.25, the zero before the decimal point is kept.
+  CHECK(shows(model, " 025"));
+  display.displayNumber(0, 4, -5, 1);                     // -0.5
+  CHECK(shows(model, " -05"));
+  display.displayNumber(0, 4, 5, 3, NUM_LEFT51);          // 0.005
+  CHECK(shows(model, "0005"));
+  display.displayNumber(0, 4, 0x1a, 0, NUM_HEX51);
+  CHECK(shows(model, "  1a"));
+  display.displayNumber(0, 4, 0x1a, 0, NUM_HEX51 | NUM_ZEROS51);
+  CHECK(shows(model, "001a"));
+  display.displayNumber(0, 4, -1, 0, NUM_HEX51);          // Taken as unsigned.
+  CHECK(shows(model, "ffff"));
+  // A number in a run of digits leaves the rest of the display alone.
+  display.displayChar(0, 8);
+  display.displayChar(3, 9);
+  display.displayNumber(1, 2, 5);
+  CHECK(shows(model, "8 59"));
+  display.displayNumber(1, 2, 5, 0, NUM_LEFT51);
+  CHECK(shows(model, "85 9"));
+  display.displayNumber(3, 2, 5);                         // Past the last digit, ignored.
+  display.displayNumber(0, 0, 5);
+  CHECK(shows(model, "85 9"));
+  CHECK_EQ(model.nacks, 0);
+}
+
+// A number too big for its run of digits fills it with uDashes, and one too negative fills it with lDashes.
+static void testOverflow(void) {
+  TM1651 display(2, 3, false, true);
+  TM1651Model model(2, 3);
+  display.begin(4, 2);
+  display.displayNumber(0, 3, 999);
+  CHECK(shows(model, "999 "));
+  display.displayNumber(0, 3, 1000);
+  CHECK(shows(model, "^^^ "));
+  display.displayNumber(0, 3, -99);
+  CHECK(shows(model, "-99 "));
+  display.displayNumber(0, 3, -100);
+  CHECK(shows(model, "___ "));
+  display.displayNumber(0, 3, 100, 0, NUM_ZEROS51);
+  CHECK(shows(model, "100 "));
+  display.displayNumber(0, 3, 100, 3);                    // 0.100 needs 4 digits.
+  CHECK(shows(model, "^^^ "));
+  display.displayNumber(0, 4, 32767);
+  CHECK(shows(model, "^^^^"));
+  display.displayNumber(0, 4, -32768);
+  CHECK(shows(model, "____"));
+  display.displayNumber(0, 4, 9999);
+  CHECK(shows(model, "9999"));
+  display.displayNumber(0, 4, -999);
+  CHECK(shows(model, "-999"));
+}
+
+// The same number, in the same format, in the same run of digits sends nothing, until something else overwrites it.
+static void testMemo(void) {
+  TM1651 display(2, 3, false, false);
+  TM1651Model model(2, 3);
+  display.begin(4, 2);
+  display.displayNumber(0, 2, -5);
+  display.displayNumber(2, 2, 42);
+  model.clearLogs();
+  display.displayNumber(0, 2, -5);
+  display.displayNumber(2, 2, 42);
+  CHECK_EQ(model.frames, 0);
+  display.displayNumber(2, 2, 42, 0, NUM_ZEROS51);        // A different format is shown.
+  CHECK_STR(model.frameText(), "");                       // The same digits, so there is nothing to send.
+  display.displayNumber(2, 2, 7, 0, NUM_ZEROS51);
+  CHECK_STR(model.frameText(), "[c2 3f] [c3 07]");
+  model.clearLogs();
+  display.displayChar(1, 8);                              // Overwrites the -5.
+  display.displayChar(1, 5);
+  model.clearLogs();
+  display.displayNumber(0, 2, -5);
+  display.displayNumber(2, 2, 7, 0, NUM_ZEROS51);         // Still remembered, the -5 did not overlap it.
+  CHECK_EQ(model.frames, 0);
+  CHECK(shows(model, "-507"));
+  display.displayClear();
+  model.clearLogs();
+  display.displayNumber(0, 2, -5);
+  CHECK_STR(model.frameText(), "[c0 40] [c1 6d]");
+}
+
+// On an LEDC68 module a fixed point number turns the decimal point ON, and a number with no decimals leaves it alone.
+static void testDecimalPoint(void) {
+  TM1651 display(2, 3, true, true);
+  TM1651Model model(2, 3);
+  display.begin(3, 2);
+  display.displayDP(ON);
+  display.displayNumber(0, 3, 12);
+  CHECK(shows(model, " 12"));
+  CHECK_EQ(model.ram[3], DP_ON51);                        // Not undone by the number.
+  display.displayDP(OFF);
+  display.displayNumber(0, 3, 12);
+  CHECK_EQ(model.ram[3], DP_OFF51);
+  display.displayNumber(0, 3, 125, 2);
+  CHECK(shows(model, "125"));
+  CHECK_EQ(model.ram[3], DP_ON51);
+  display.displayDP(OFF);                                 // The fixed point number is no longer on the display...
+  model.clearLogs();
+  display.displayNumber(0, 3, 125, 2);                    // ... so it is shown again.
+  CHECK_STR(model.frameText(), "[c3 08]");
+  // Runs of digits with and without decimals do not forget each other.
+  display.displayNumber(0, 1, 3);
+  display.displayNumber(1, 2, 25, 1);
+  model.clearLogs();
+  display.displayNumber(0, 1, 3);
+  display.displayNumber(1, 2, 25, 1);
+  CHECK_EQ(model.frames, 0);
+  CHECK(shows(model, "325"));
+  CHECK_EQ(model.ram[3], DP_ON51);
+}
+
+// Time the conversion of every decimal number, with the writes held back, against the reference conversion.
+static void benchConversion(void) {
+  TM1651 display(2, 3, false, true);
+  TM1651Model model(2, 3);
+  volatile uint8_t sink = 0;
+  uint16_t number, value;
+  uint8_t digit;
+  display.begin(4, 2);
+  display.beginUpdate();                                  // Only the conversion, no bus writes.
+  auto start = std::chrono::steady_clock::now();
+  for(number = 0; number <= 9999; number++) {
+    display.displayInt16(0, number, true);
+  }
+  auto middle = std::chrono::steady_clock::now();
+  for(number = 0; number <= 9999; number++) {
+    for(value = number, digit = 0; digit < 4; digit++) {
+      sink = sink + TM1651::charCode(value % 10);
+      value /= 10;
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  printf("displayInt16() conversion: %.1f ns/number, reference / and %%: %.1f ns/number (host, for comparison only)\n",
+         std::chrono::duration<double, std::nano>(middle - start).count() / 10000.0,
+         std::chrono::duration<double, std::nano>(end - middle).count() / 10000.0);
+  display.commit();
+}
+
+int main(void) {
+  testExhaustive();
+  testIncrement();
+  testFormats();
+  testOverflow();
+  testMemo();
+  testDecimalPoint();
+  benchConversion();
+  return(hostResult("testNumbers"));
+}
+
+// EOF
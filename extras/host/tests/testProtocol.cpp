@@ -0,0 +1,110 @@
+/*!
+ * The TM1651 protocol, as seen by a pin level TM1651 model - the frames, the display RAM, the address modes,
+ * the digit map and the ACK.
+ */
+
+#include "easiTM1651.h"
+#include "tm1651Model.h"
+#include "hostCheck.h"
+
+// Check the display RAM of the model matches the registers recorded by the library.
+static void checkRegisters(TM1651& display, TM1651Model& model, uint8_t digits) {
+  uint8_t digit;
+  for(digit = 0; digit < digits; digit++) {
+    CHECK_EQ(model.ram[digit], display.readRegister(digit));
+  }
+}
+
+// Auto address mode, with an LEDC68 module.
+static void testAutoMode(void) {
+  TM1651 display(2, 3, true, true);
+  TM1651Model model(2, 3);
+  display.begin(3, 2);
+  CHECK_STR(model.frameText(), "[40] [c0 00 00 00 00] [8a]");
+  CHECK(model.autoMode);
+  CHECK_EQ(model.control, DISP_ON51 + 2);
+  model.clearLogs();
+  display.displayChar(0, 1);
+  CHECK_STR(model.frameText(), "[c0 06]");
+  model.clearLogs();
+  display.displayInt12(0, 123);
+  CHECK_STR(model.frameText(), "[c1 5b 4f]");                   // Only the changed digits, in one burst.
+  model.clearLogs();
+  display.displayInt12(0, 123);
+  CHECK_EQ(model.frames, 0);                                    // Nothing has changed.
+  display.displayDP(ON);
+  CHECK_STR(model.frameText(), "[c3 08]");
+  checkRegisters(display, model, MAX_DIGITS51);
+  model.clearLogs();
+  display.displayBrightness(7);
+  CHECK_STR(model.frameText(), "[8f]");
+  model.clearLogs();
+  display.displayOff();
+  CHECK_STR(model.frameText(), "[80]");
+  CHECK_EQ(model.nacks, 0);
+}
+
+// Fixed address mode, with a 4-digit module.
+static void testFixedMode(void) {
+  TM1651 display(4, 5, false, false);
+  TM1651Model model(4, 5);
+  display.begin(4, 3);
+  CHECK(!model.autoMode);
+  CHECK_EQ(model.control, DISP_ON51 + 3);
+  model.clearLogs();
+  display.displayInt16(0, 0x1a2b, false);
+  CHECK_STR(model.frameText(), "[c0 06] [c1 77] [c2 5b] [c3 7c]");
+  checkRegisters(display, model, 4);
+  model.clearLogs();
+  display.beginUpdate();
+  display.displayChar(1, 0);
+  display.displayChar(3, 0);
+  CHECK_EQ(model.frames, 0);                                    // Held back until commit().
+  display.commit();
+  CHECK_STR(model.frameText(), "[c1 3f] [c3 3f]");
+  checkRegisters(display, model, 4);
+}
+
+// A digit map puts the logical digits at their physical addresses, in both address modes.
+static void testDigitMap(bool addrAuto) {
+  uint8_t digitMap[3] = {2, 1, 0};
+  TM1651 display(6, 7, false, addrAuto);
+  TM1651Model model(6, 7);
+  display.begin(digitMap, 3, 2);
+  display.displayInt12(0, 123);
+  CHECK_EQ(model.ram[0], TM1651::charCode(3));
+  CHECK_EQ(model.ram[1], TM1651::charCode(2));
+  CHECK_EQ(model.ram[2], TM1651::charCode(1));
+  CHECK_EQ(display.readRegister(0), TM1651::charCode(1));      // The registers stay in logical order.
+}
+
+// A byte that is not acknowledged is counted, and the frame is sent again.
+static void testAck(void) {
+  TM1651 display(2, 3, true, true);
+  TM1651Model model(2, 3);
+  display.begin(3, 2);
+  display.resetStats();
+  model.clearLogs();
+  model.nackBytes = 1;
+  display.displayChar(2, 8);
+  CHECK_EQ(display.getStats().nacks, 1);
+  CHECK_EQ(display.getStats().retries, 1);
+  CHECK_EQ(model.nacks, 1);
+  CHECK_EQ(model.ram[2], TM1651::charCode(8));
+  // A slow ACK is still seen within the ACK wait.
+  model.ackDelay = DEF_ACKWAIT51 - 1;
+  display.displayChar(2, 7);
+  CHECK_EQ(display.getStats().nacks, 1);
+  CHECK_EQ(model.ram[2], TM1651::charCode(7));
+}
+
+int main(void) {
+  testAutoMode();
+  testFixedMode();
+  testDigitMap(true);
+  testDigitMap(false);
+  testAck();
+  return(hostResult("testProtocol"));
+}
+
+// EOF
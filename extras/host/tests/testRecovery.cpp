@@ -0,0 +1,67 @@
+/*!
+ * The recovery from a failed frame - the retries, the rewrite of the whole display, and a rewrite that fails too, on a
+ * bus that is dead for a while. Built synchronous and asynchronous (USEASYNCMODE51), the display must recover the same.
+ */
+
+#include "easiTM1651.h"
+#include "tm1651Model.h"
+#include "hostCheck.h"
+
+// Check the display RAM and display control of the model match the display.
+static void checkDisplay(TM1651& display, TM1651Model& model) {
+  uint8_t digit;
+  for(digit = 0; digit < MAX_DIGITS51; digit++) {
+    CHECK_EQ(model.ram[digit], display.readRegister(digit));
+  }
+  CHECK_EQ(model.control, display.cmdDispCtrl);
+}
+
+// A frame that fails on a dead bus, and so does its rewrite - the next frame, once the bus is back, rewrites the whole display.
+static void testDeadBus(void) {
+  TM1651 display(2, 3, true, true);
+  TM1651Model model(2, 3);
+  display.begin(3, 5);
+  display.displayInt12(0, 123);
+  CHECK(display.flush());
+  model.nackAll = true;
+  display.displayChar(0, 5);
+  CHECK(!display.flush());
+  model.nackAll = false;
+  memset(model.ram, 0x00, sizeof(model.ram));             // As a module that lost power.
+  model.control = 0x00;
+  model.clearLogs();
+  display.displayChar(1, 7);
+  CHECK(display.flush());
+  checkDisplay(display, model);
+  CHECK_EQ(model.ram[0], TM1651::charCode(5));            // The digit written while the bus was dead.
+  CHECK(model.frameText().find("[c0 6d 07 4f") != std::string::npos);
+  model.clearLogs();
+  display.displayChar(2, 1);
+  CHECK(display.flush());
+  CHECK_STR(model.frameText(), "[c2 06]");                // Back to normal.
+}
+
+// A frame that fails once is sent again, and nothing else is rewritten.
+static void testRetry(void) {
+  TM1651 display(2, 3, true, true);
+  TM1651Model model(2, 3);
+  display.begin(3, 5);
+  CHECK(display.flush());
+  model.clearLogs();
+  display.resetStats();
+  model.nackBytes = 1;
+  display.displayChar(0, 5);
+  CHECK(display.flush());
+  CHECK_STR(model.frameText(), "[c0 6d] [c0 6d]");          // The model logs the NACKed frame too.
+  CHECK_EQ(display.getStats().retries, 1);
+  CHECK_EQ(display.getStats().resyncs, 0);
+  checkDisplay(display, model);
+}
+
+int main(void) {
+  testDeadBus();
+  testRetry();
+  return(hostResult("testRecovery"));
+}
+
+// EOF
@@ -0,0 +1,161 @@
+/*!
+ * The Stream front-end, fed by a mock stream - the frames decoded, the order of the digit and brightness writes, an
+ * update held by the caller or a TM1651Array, and the dropped frames and statistics.
+ */
+
+#include "easiTM1651.h"
+#include "tm1651Model.h"
+#include "hostCheck.h"
+#include <deque>
+
+// A stream of canned bytes, standing in for Serial.
+class MockStream : public Stream {
+  public:
+    std::deque<uint8_t> bytes;                            // The bytes waiting to be read.
+    int available(void) { return((int)bytes.size()); }
+    int read(void) {
+      if(bytes.empty()) {
+        return(-1);
+      }
+      uint8_t byte = bytes.front();
+      bytes.pop_front();
+      return(byte);
+    }
+    int peek(void) { return(bytes.empty() ? -1 : bytes.front()); }
+    size_t write(uint8_t) { return(1); }
+    // Queue a frame of an op and its payload, with the sync, the length and the check.
+    void frame(uint8_t op, std::initializer_list<uint8_t> payload) {
+      uint8_t check = op ^ (uint8_t)payload.size();
+      bytes.push_back(STREAMSYNC51);
+      bytes.push_back(op);
+      bytes.push_back((uint8_t)payload.size());
+      for(uint8_t byte : payload) {
+        bytes.push_back(byte);
+        check ^= byte;
+      }
+      bytes.push_back(check);
+    }
+};
+
+// The digits of the frames of one tick() go out in one burst, and a brightness change goes after them.
+static void testFrames(bool addrAuto) {
+  TM1651 display(2, 3, true, addrAuto);
+  TM1651Model model(2, 3);
+  MockStream stream;
+  TM1651Stream front(display, stream);
+  display.begin(3, 2);
+  model.clearLogs();
+  stream.frame(OP_RAW51, {0, 0x06, 0x5b});
+  stream.frame(OP_BRIGHT51, {7});
+  stream.frame(OP_RAW51, {2, 0x4f});
+  stream.frame(OP_DP51, {1});
+  front.tick(0);
+  CHECK_STR(model.frameText(), addrAuto ? "[c0 06 5b 4f 08] [8f]" : "[c0 06] [c1 5b] [c2 4f] [c3 08] [8f]");
+  CHECK_EQ(model.ram[2], 0x4f);
+  CHECK_EQ(front.getStats().frames, 4);
+  // Only the last brightness change of a tick() is sent, and anything over the maximum turns the display OFF.
+  model.clearLogs();
+  stream.frame(OP_BRIGHT51, {3});
+  stream.frame(OP_BRIGHT51, {0xff});
+  front.tick(0);
+  CHECK_STR(model.frameText(), "[80]");
+  // A frame split over two tick() calls waits for the rest of its bytes.
+  model.clearLogs();
+  stream.frame(OP_NUMBER51, {0, 3, 0xc8, 0x01, 0, 0});    // 456 on 3 digits, with no decimal point.
+  stream.bytes.pop_back();
+  front.tick(0);
+  CHECK_EQ(model.frames, 0);
+  stream.bytes.push_back(OP_NUMBER51 ^ 6 ^ 0 ^ 3 ^ 0xc8 ^ 0x01);
+  front.tick(0);
+  CHECK_EQ(model.frames, addrAuto ? 1 : 3);
+  CHECK_EQ(model.ram[0], TM1651::charCode(4));
+  CHECK_EQ(model.ram[2], TM1651::charCode(6));
+  CHECK_EQ(model.ram[3], DP_ON51);                        // A number with no decimals leaves the decimal point alone.
+  CHECK(model.nacks == 0);
+}
+
+// An update held by the caller stays held, and its commit() writes the digits of the stream.
+static void testHeld(void) {
+  TM1651 display(2, 3, true, true);
+  TM1651Model model(2, 3);
+  MockStream stream;
+  TM1651Stream front(display, stream);
+  display.begin(3, 2);
+  model.clearLogs();
+  display.beginUpdate();
+  display.displayChar(2, 7);
+  stream.frame(OP_RAW51, {0, 0x06});
+  front.tick(0);
+  CHECK_EQ(model.frames, 0);
+  stream.frame(OP_RAW51, {1, 0x5b});
+  front.tick(0);
+  CHECK_EQ(model.frames, 0);                              // Still held after the first tick().
+  display.commit();
+  CHECK_STR(model.frameText(), "[c0 06 5b 07]");
+}
+
+// A module of a TM1651Array stays held, and the array's commit() writes the digits of the stream.
+static void testArray(void) {
+  TM1651 displays[] = {TM1651(2, 3, true, true), TM1651(2, 4, true, true)};
+  TM1651Model model0(2, 3), model1(2, 4);
+  TM1651Array array(displays, 2);
+  MockStream stream;
+  TM1651Stream front(displays[0], stream);
+  array.begin(3, 2);
+  model0.clearLogs();
+  model1.clearLogs();
+  stream.frame(OP_RAW51, {0, 0x06, 0x5b, 0x4f});
+  displays[1].displayChar(0, 9);
+  front.tick(0);
+  CHECK_EQ(model0.frames, 0);
+  CHECK_EQ(array.commit(), 0x00);
+  CHECK_STR(model0.frameText(), "[c0 06 5b 4f]");
+  CHECK_EQ(model1.ram[0], TM1651::charCode(9));
+}
+
+// Frames with a bad check, length, op or payload are dropped, the decoder finds the next sync, and a burst larger
+// than the ring buffer is decoded in one tick().
+static void testDropped(void) {
+  TM1651 display(2, 3, true, true);
+  TM1651Model model(2, 3);
+  MockStream stream;
+  TM1651Stream front(display, stream);
+  uint8_t frame;
+  display.begin(3, 2);
+  model.clearLogs();
+  stream.frame(OP_RAW51, {0, 0x06});
+  stream.bytes.back() ^= 0x01;                            // A bad check.
+  stream.bytes.push_back(0x00);                           // Noise between the frames.
+  stream.frame(0x7f, {0});                                // A bad op.
+  stream.frame(OP_RAW51, {3, 0x06, 0x06});                // Past the last digit.
+  stream.bytes.push_back(STREAMSYNC51);                   // A bad length.
+  stream.bytes.push_back(OP_RAW51);
+  stream.bytes.push_back(STREAMMAXLEN51 + 1);
+  for(frame = 0; frame < 10; frame++) {                   // 60 bytes of good frames.
+    stream.frame(OP_RAW51, {(uint8_t)(frame % 3), TM1651::charCode(frame)});
+  }
+  front.tick(0);
+  CHECK_EQ(stream.available(), 0);
+  CHECK_EQ(front.getStats().frames, 10);
+  CHECK_EQ(front.getStats().bytes, 60);
+  CHECK_EQ(front.getStats().dropped, 4);
+  CHECK_EQ(model.frames, 1);                              // The digits 9, 7 and 8, in one burst.
+  CHECK_EQ(model.ram[0], TM1651::charCode(9));
+  CHECK_EQ(model.ram[1], TM1651::charCode(7));
+  CHECK_EQ(model.ram[2], TM1651::charCode(8));
+  front.tick(STREAMRATE51);
+  CHECK_EQ(front.getStats().rate, 60);
+  front.resetStats();
+  CHECK_EQ(front.getStats().frames, 0);
+}
+
+int main(void) {
+  testFrames(true);
+  testFrames(false);
+  testHeld();
+  testArray();
+  testDropped();
+  return(hostResult("testStream"));
+}
+
+// EOF
@@ -0,0 +1,65 @@
+/*!
+ * The TM1651T class template - the same frames as a TM1651 configured the same way, and the same size.
+ */
+
+#include "easiTM1651.h"
+#include "tm1651Model.h"
+#include "hostCheck.h"
+
+static_assert(sizeof(TM1651T<2, 3>) == sizeof(TM1651), "A TM1651T is a TM1651, nothing is folded out of its layout.");
+
+// Run the same calls on a display, returning the frames the model received.
+template<typename DISPLAY> static std::string runCalls(DISPLAY& display, TM1651Model& model) {
+  display.template displayChar<0>(5);
+  display.template displayInt8<1>(42);
+  display.displayDP(ON);
+  display.template displayNumber<0, 3>(-12);
+  return(model.frameText());
+}
+
+static void testSameFrames(bool addrAuto) {
+  std::string expected;
+  {
+    TM1651 display(2, 3, true, addrAuto);
+    TM1651Model model(2, 3);
+    display.begin(3, 2);
+    display.displayChar(0, 5);
+    display.displayInt8(1, 42);
+    display.displayDP(ON);
+    display.displayNumber(0, 3, -12);
+    expected = model.frameText();
+  }
+  if(addrAuto) {
+    TM1651T<2, 3, 3, true> display;
+    TM1651Model model(2, 3);
+    display.begin();
+    CHECK_STR(runCalls(display, model), expected);
+  }
+  else {
+    TM1651T<2, 3, 3, false> display;
+    TM1651Model model(2, 3);
+    display.begin();
+    CHECK_STR(runCalls(display, model), expected);
+  }
+}
+
+// Without an LEDC68, displayDP() sends nothing.
+static void testNoDP(void) {
+  TM1651T<2, 3, 4, true, false> display;
+  TM1651Model model(2, 3);
+  display.begin();
+  model.clearLogs();
+  display.displayDP(ON);
+  CHECK_EQ(model.frames, 0);
+  display.displayInt16<0>(1234);
+  CHECK_EQ(model.ram[3], TM1651::charCode(4));
+}
+
+int main(void) {
+  testSameFrames(true);
+  testSameFrames(false);
+  testNoDP();
+  return(hostResult("testTemplate"));
+}
+
+// EOF
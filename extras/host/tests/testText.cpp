@@ -0,0 +1,108 @@
+/*!
+ * The ASCII text - the font of displayString() from RAM and flash against tmAscii51(), the raw codes of displayText(),
+ * the truncation at the last digit, and a '.' that never touches the decimal point.
+ */
+
+#include "easiTM1651.h"
+#include "tm1651Model.h"
+#include "hostCheck.h"
+
+// tmAscii51() is worked out by the compiler.
+static_assert(tmAscii51('1') == tmSegments51("bc"), "tmAscii51() must be a constant expression.");
+static_assert(tmAscii51('\x1f') == 0x00, "A character below the font must be blank.");
+
+// Every printable character is shown with the font in flash, the same codes as tmAscii51() works out at compile time.
+static void testFont(void) {
+  static const uint8_t font[] = {tmAscii51(' '), tmAscii51('-'), tmAscii51('0'), tmAscii51('9'), tmAscii51('A'),
+                                 tmAscii51('H'), tmAscii51('b'), tmAscii51('o'), tmAscii51('~'), tmAscii51('\x7f')};
+  static const char text[] = " -09AHbo~\x7f";
+  TM1651 display(2, 3, false, true);
+  TM1651Model model(2, 3);
+  char character[2] = {0x00, 0x00};
+  uint8_t index;
+  display.begin(4, 2);
+  for(index = 0; index < sizeof(font); index++) {
+    character[0] = text[index];
+    display.displayString(0, character);
+    CHECK_EQ(model.ram[0], font[index]);
+  }
+  for(index = 0x20; index < 0x80; index++) {
+    character[0] = index;
+    display.displayString(1, character);
+    CHECK_EQ(model.ram[1], pgm_read_byte(&TM1651::tmAsciiTable[index - 0x20]));
+  }
+  CHECK_EQ(model.ram[0], 0x00);                           // Only the digits of the string are written.
+  character[0] = (char)0x80;                              // Past the end of the font.
+  display.displayString(1, character);
+  CHECK_EQ(model.ram[1], 0x00);
+  display.displayString(0, "H1");
+  CHECK_EQ(model.ram[0], tmAscii51('H'));
+  CHECK_EQ(model.ram[1], tmAscii51('1'));
+  CHECK_EQ(model.nacks, 0);
+}
+
+// A string stops at its end or the last digit, in one burst, and a string from flash is shown the same way.
+static void testTruncation(void) {
+  TM1651 display(2, 3, false, true);
+  TM1651Model model(2, 3);
+  display.begin(3, 2);
+  model.clearLogs();
+  display.displayString(0, "HELLO");
+  CHECK_STR(model.frameText(), "[c0 76 79 38]");
+  model.clearLogs();
+  display.displayString(2, F("Lo"));
+  display.displayString(3, "X");                          // Past the last digit.
+  display.displayString(1, "");
+  CHECK_EQ(model.frames, 0);                              // "L" is already in digit 2.
+  display.displayString(1, F("ab"));
+  CHECK_STR(model.frameText(), "[c1 5f 7c]");
+  CHECK_EQ(model.ram[0], tmAscii51('H'));
+}
+
+// The raw codes of displayText() stop at the last digit, and are limited to 7 bits.
+static void testText(void) {
+  static const uint8_t hello[] = {tmAscii51('H'), tmAscii51('E'), tmAscii51('L'), tmAscii51('L'), tmAscii51('O')};
+  static const uint8_t codes[] = {0xff, 0x80};
+  TM1651 display(2, 3, false, false);
+  TM1651Model model(2, 3);
+  display.begin(4, 2);
+  model.clearLogs();
+  display.displayText(1, hello, sizeof(hello));
+  CHECK_STR(model.frameText(), "[c1 76] [c2 79] [c3 38]");
+  display.displayText(0, codes, sizeof(codes));
+  CHECK_EQ(model.ram[0], 0x7f);
+  CHECK_EQ(model.ram[1], 0x00);
+  model.clearLogs();
+  display.displayText(2, hello, 0);
+  CHECK_EQ(model.frames, 0);
+}
+
+// A '.' takes a digit of its own and is blank, it never turns the LEDC68 decimal point ON or OFF.
+static void testPoint(void) {
+  TM1651 display(2, 3, true, true);
+  TM1651Model model(2, 3);
+  display.begin(3, 2);
+  display.displayString(0, "1.5");
+  CHECK_EQ(model.ram[0], tmAscii51('1'));
+  CHECK_EQ(model.ram[1], 0x00);
+  CHECK_EQ(model.ram[2], tmAscii51('5'));
+  CHECK_EQ(model.ram[3], DP_OFF51);
+  display.displayDP(ON);
+  display.displayString(0, "2...");                       // The last '.' is past the last digit, not the DP control.
+  CHECK_EQ(model.ram[1], 0x00);
+  CHECK_EQ(model.ram[2], 0x00);
+  CHECK_EQ(model.ram[3], DP_ON51);
+  display.displayText(0, (const uint8_t*)"\xff\xff\xff\xff", 4);
+  CHECK_EQ(model.ram[2], 0x7f);
+  CHECK_EQ(model.ram[3], DP_ON51);                        // Only 3 digits, and only 7 bits of each code.
+}
+
+int main(void) {
+  testFont();
+  testTruncation();
+  testText();
+  testPoint();
+  return(hostResult("testText"));
+}
+
+// EOF
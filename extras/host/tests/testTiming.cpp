@@ -0,0 +1,67 @@
+/*!
+ * The bus timing profile - calibrate() with a slow ACK, the margin on every time, and the profile handed to a transport.
+ */
+
+#include "easiTM1651.h"
+#include "tm1651Model.h"
+#include "hostCheck.h"
+
+// A transport that acknowledges everything, and records the timing profile it was given.
+class TimingTransport : public TM1651Transport {
+  public:
+    TM1651Timing timing = {0, 0, 0, 0};
+    uint8_t timings = 0;
+    void setTiming(TM1651Timing newTiming) { timing = newTiming; timings++; }
+    void start(void) {}
+    void writeByte(uint8_t) {}
+    bool busy(void) { return(false); }
+    bool ack(void) { return(true); }
+    void stop(void) {}
+};
+
+// calibrate() finds the shortest times that pass, then adds the margin to every one of them, even those that reach 0.
+static void testCalibrate(void) {
+  TM1651 display(2, 3, true, true);
+  TM1651Model model(2, 3);
+  TM1651Timing timing;
+  display.begin(3, 2);
+  display.displayInt12(0, 123);
+  model.ackDelay = 3;
+  timing = display.calibrate();
+  CHECK_EQ(timing.ackWait, 3 + CAL_MARGIN51);             // The ACK is read one wait after the 8th falling clock edge.
+  CHECK_EQ(timing.clkHigh, CAL_MARGIN51);                 // The model has no minimum clock or setup time.
+  CHECK_EQ(timing.clkLow, CAL_MARGIN51);
+  CHECK_EQ(timing.setup, CAL_MARGIN51);
+  CHECK_EQ(display.getTiming().ackWait, timing.ackWait);
+  CHECK_EQ(model.ram[0], TM1651::charCode(1));            // The whole display is resent afterwards.
+  CHECK_EQ(model.ram[2], TM1651::charCode(3));
+  CHECK_EQ(model.control, DISP_ON51 + 2);
+  model.clearLogs();
+  display.displayChar(1, 7);
+  CHECK_EQ(model.nacks, 0);                               // And the calibrated timing works.
+}
+
+// A transport is given the timing profile when it is set, when the profile changes, and by calibrate().
+static void testTransport(void) {
+  TM1651 display(2, 3, true, true);
+  TimingTransport transport;
+  TM1651Timing timing = {2, 2, 2, 9};
+  display.setTransport(&transport);
+  CHECK_EQ(transport.timing.ackWait, DEF_ACKWAIT51);
+  display.begin(3, 2);
+  display.setTiming(timing);
+  CHECK_EQ(transport.timing.ackWait, 9);
+  CHECK_EQ(transport.timing.clkHigh, 2);
+  timing = display.calibrate();
+  CHECK_EQ(transport.timing.ackWait, timing.ackWait);
+  CHECK_EQ(timing.ackWait, CAL_MARGIN51);                 // It always ACKs.
+  CHECK(transport.timings > 3);
+}
+
+int main(void) {
+  testCalibrate();
+  testTransport();
+  return(hostResult("testTiming"));
+}
+
+// EOF
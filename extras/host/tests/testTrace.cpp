@@ -0,0 +1,61 @@
+/*!
+ * The pin trace, built with USEPINTRACE51 - the VCD file of the latest pin changes, and the latency histograms of the
+ * start, writeByte and stop calls, or of their service() steps when built with USEASYNCMODE51 too.
+ */
+
+#include "easiTM1651.h"
+#include "tm1651Model.h"
+#include "hostCheck.h"
+#include <stdlib.h>
+#include <string>
+
+// A Print that collects the text written to it.
+class TextPrint : public Print {
+  public:
+    std::string text;
+    size_t write(uint8_t byte) { text += (char)byte; return(1); }
+};
+
+// Get the total count of a call in the latency summary, e.g. "start".
+static unsigned long callCount(const std::string& summary, const char* call) {
+  unsigned long count = 0;
+  size_t at = summary.find(std::string(call) + ":"), end = summary.find('\n', at);
+  while(at != std::string::npos && (at = summary.find('=', at)) != std::string::npos && at < end) {
+    count += strtoul(summary.c_str() + ++at, NULL, 10);
+  }
+  return(count);
+}
+
+int main(void) {
+  TM1651 display(2, 3, true, false);
+  TM1651Model model(2, 3);
+  TextPrint vcd, summary;
+  size_t lines = 0, at;
+  display.begin(3, 2);
+  display.flush();
+  display.traceClear();
+  model.clearLogs();
+  display.displayDP(ON);
+  CHECK(display.flush());                                 // Send any queued frame.
+  CHECK_STR(model.frameText(), "[c3 08]");
+  display.traceSummary(summary);
+  CHECK_EQ(callCount(summary.text, "start"), 1);
+  CHECK_EQ(callCount(summary.text, "writeByte"), 2);
+  CHECK_EQ(callCount(summary.text, "stop"), 1);
+  display.traceVCD(vcd);
+  CHECK(vcd.text.find("$timescale " TRACESCALE51 " $end\n") == 0);
+  CHECK(vcd.text.find("#0\n") != std::string::npos);
+  for(at = vcd.text.find("$enddefinitions"); (at = vcd.text.find('\n', at + 1)) != std::string::npos; ) {
+    if(at + 2 < vcd.text.size() && vcd.text[at + 1] != '#') {
+      lines++;
+    }
+  }
+  CHECK(lines > 0 && lines <= TRACEBUF51 + 2);           // Only the latest pin changes, the first dumps every pin.
+  display.traceClear();
+  vcd.text.clear();
+  display.traceVCD(vcd);
+  CHECK(vcd.text.find('#') == std::string::npos);
+  return(hostResult("testTrace"));
+}
+
+// EOF
@@ -0,0 +1,129 @@
+/*!
+ * A mock transport - the frame stream sent through a transport matches the bit banged one, the pins are left alone,
+ * and busy(), the NACKs, the retries and the statistics work the same. Built synchronous and asynchronous (USEASYNCMODE51).
+ */
+
+#include "easiTM1651.h"
+#include "tm1651Model.h"
+#include "hostCheck.h"
+#include <algorithm>
+
+// A transport that logs every frame as the model does, e.g. "[40] [c0 06]", is busy for a while with each byte, and can NACK.
+class MockTransport : public TM1651Transport {
+  public:
+    std::string frames;
+    uint8_t busyCount = 0;                                // busy() is true this many times for each byte.
+    uint32_t nackBytes = 0;                               // Do not acknowledge this many of the next bytes.
+    uint32_t busyCalls = 0;
+    bool began = false;
+    void begin(void) { began = true; }
+    void start(void) { frames += frames.empty() ? "[" : " ["; _first = true; }
+    void writeByte(uint8_t data) {
+      char hex[4];
+      snprintf(hex, sizeof(hex), _first ? "%02x" : " %02x", data);
+      frames += hex;
+      _first = false;
+      _busy = busyCount;
+    }
+    bool busy(void) {
+      busyCalls++;
+      if(_busy > 0) {
+        _busy--;
+        return(true);
+      }
+      return(false);
+    }
+    bool ack(void) {
+      if(nackBytes > 0) {
+        nackBytes--;
+        return(false);
+      }
+      return(true);
+    }
+    void stop(void) { frames += "]"; }
+  private:
+    bool _first = true;
+    uint8_t _busy = 0;
+};
+
+// Run the same display calls on a display.
+static void runCalls(TM1651& display) {
+  display.begin(3, 2);
+  display.displayInt12(0, 123);
+  display.displayDP(ON);
+  display.displayBrightness(7);
+  display.displayTest(true);
+  display.displayTest(false);
+  display.displayOff();
+  display.flush();
+}
+
+// The frames through the transport are the same as the bit banged frames, and nothing is bit banged.
+static void testSameFrames(bool addrAuto) {
+  std::string expected;
+  {
+    TM1651 display(2, 3, true, addrAuto);
+    TM1651Model model(2, 3);
+    runCalls(display);
+    expected = model.frameText();
+  }
+  TM1651 display(2, 3, true, addrAuto);
+  TM1651Model model(2, 3);
+  MockTransport transport;
+  transport.busyCount = 3;
+  display.setTransport(&transport);
+  CHECK(transport.began);
+  runCalls(display);
+  CHECK_STR(transport.frames, expected);
+  CHECK_EQ(model.frames, 0);                              // The pins are left alone.
+  CHECK(transport.busyCalls > 0);
+  CHECK_EQ(display.getStats().frames, (long long)std::count(expected.begin(), expected.end(), '['));
+}
+
+// A NACK through the transport is retried, and a frame that keeps failing rewrites the whole display.
+static void testNack(void) {
+  TM1651 display(2, 3, true, true);
+  MockTransport transport;
+  display.setTransport(&transport);
+  display.begin(3, 2);
+  display.flush();
+  display.resetStats();
+  transport.frames.clear();
+  transport.nackBytes = 1;
+  display.displayChar(0, 5);
+  CHECK(display.flush());
+  CHECK_STR(transport.frames, "[c0 6d] [c0 6d]");
+  CHECK_EQ(display.getStats().nacks, 1);
+  CHECK_EQ(display.getStats().retries, 1);
+  transport.frames.clear();
+  transport.nackBytes = 2 * (1 + DEF_RETRIES51);          // The frame and both its retries.
+  display.displayChar(1, 7);
+  CHECK(!display.flush());
+  CHECK_STR(transport.frames, "[c1 07] [c1 07] [c1 07] [8a] [40] [c0 6d 07 00 00]");
+  CHECK_EQ(display.getStats().resyncs, 1);
+  CHECK(display.flush());                                 // Only the last flush() reports the failure.
+}
+
+// Back to bit banging the pins.
+static void testBitBangAgain(void) {
+  TM1651 display(2, 3, true, true);
+  TM1651Model model(2, 3);
+  MockTransport transport;
+  display.setTransport(&transport);
+  display.begin(3, 2);
+  display.flush();
+  display.setTransport(nullptr);
+  display.displayChar(0, 1);
+  display.flush();
+  CHECK_STR(model.frameText(), "[c0 06]");
+}
+
+int main(void) {
+  testSameFrames(true);
+  testSameFrames(false);
+  testNack();
+  testBitBangAgain();
+  return(hostResult("testTransport"));
+}
+
+// EOF
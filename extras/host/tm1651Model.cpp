@@ -0,0 +1,157 @@
+/*!
+ * A pin level model of a TM1651, for testing the easiTM1651 library on a host.
+ *
+ * ****************************
+ * *  TM1651 Model Code File  *
+ * ****************************
+*/
+
+#include "tm1651Model.h"
+#include <stdio.h>
+
+#define ACKPHASE51      9                                 // The bit count from the 8th falling clock edge to the 9th, while the ACK is driven.
+
+// Class constructor - with the clock and data pins it is wired to.
+TM1651Model::TM1651Model(uint8_t clkPin, uint8_t dioPin) {
+  _clkPin = clkPin;
+  _dioPin = dioPin;
+  _clk = HIGH;                                            // The lines idle HIGH, pulled up.
+  _dio = HIGH;
+  _inFrame = false;
+  _bit = 0;
+  _byte = 0x00;
+  _address = 0;
+  _command = 0x00;
+  _acking = false;
+  _ackTime = 0;
+  memset(ram, 0x00, sizeof(ram));
+  control = 0x00;
+  autoMode = true;
+  nackBytes = 0;
+  nackAll = false;
+  ackDelay = 0;
+  logEdges = false;
+  this->clearLogs();
+}
+
+// Clear the counters and the logs, but not the display RAM.
+void TM1651Model::clearLogs(void) {
+  frames = 0;
+  bytes = 0;
+  nacks = 0;
+  edges.clear();
+  frameLog.clear();
+}
+
+// Get the frame log as text, e.g. "[40] [c0 06 5b 4f]".
+std::string TM1651Model::frameText(void) {
+  std::string text;
+  char hex[4];
+  size_t frame, index;
+  for(frame = 0; frame < frameLog.size(); frame++) {
+    text += (frame == 0) ? "[" : " [";
+    for(index = 0; index < frameLog[frame].size(); index++) {
+      snprintf(hex, sizeof(hex), (index == 0) ? "%02x" : " %02x", frameLog[frame][index]);
+      text += hex;
+    }
+    text += "]";
+  }
+  return(text);
+}
+
+// Look at the pin levels, and decode any clock edge, start signal or stop signal.
+void TM1651Model::pinsChanged(void) {
+  uint8_t clk, dio;
+  clk = hostPinLevel(_clkPin);
+  dio = hostPinLevel(_dioPin);
+  if(clk != _clk) {
+    _clk = clk;
+    if(logEdges) {
+      edges += clk ? 'C' : 'c';
+    }
+    if(_inFrame) {
+      if(clk == HIGH) {                                   // Read the bits on the rising edges, LSB first.
+        if(_bit < 8) {
+          if(dio) {
+            _byte |= (1 << _bit);
+          }
+          _bit++;
+        }
+      }
+      else if(_bit == 8) {                                // The 8th falling edge - the byte is complete, so ACK it.
+        _bit = ACKPHASE51;
+        _ackTime = micros();
+        _acking = !nackAll && nackBytes == 0;
+        if(nackBytes > 0) {
+          nackBytes--;
+        }
+        _frame.push_back(_byte);
+        bytes++;
+        if(_acking) {
+          this->gotByte(_byte);
+        }
+        else {
+          nacks++;                                        // A byte that is not acknowledged was not received.
+        }
+      }
+      else if(_bit == ACKPHASE51) {                       // The 9th falling edge - release the data line for the next byte.
+        _bit = 0;
+        _byte = 0x00;
+        _acking = false;
+      }
+    }
+  }
+  if(dio != _dio) {
+    _dio = dio;
+    if(logEdges) {
+      edges += dio ? 'D' : 'd';
+    }
+    if(clk == HIGH && _bit != ACKPHASE51) {               // The data only changes with the clock HIGH for a start or stop signal.
+      if(dio == LOW) {                                    // A start signal.
+        _inFrame = true;
+        _bit = 0;
+        _byte = 0x00;
+        _command = 0x00;
+        _frame.clear();
+      }
+      else if(_inFrame) {                                 // A stop signal.
+        _inFrame = false;
+        frames++;
+        frameLog.push_back(_frame);
+      }
+    }
+  }
+}
+
+// Check if the model is pulling a pin LOW - the data pin, for the ACK, once the ACK delay has passed.
+bool TM1651Model::pullsLow(uint8_t pin) {
+  return(pin == _dioPin && _bit == ACKPHASE51 && _acking && (micros() - _ackTime) >= ackDelay);
+}
+
+// Carry out a received byte - the first byte of a frame is a command, any more bytes are data for the display RAM.
+void TM1651Model::gotByte(uint8_t data) {
+  if(_frame.size() == 1) {
+    _command = data;
+    switch(data & 0xc0) {
+      case 0x40:                                          // Data command, the address mode.
+        autoMode = !(data & 0x04);
+        break;
+      case 0x80:                                          // Display control command.
+        control = data;
+        break;
+      case 0xc0:                                          // Address command.
+        _address = data & 0x3f;
+        break;
+    }
+  }
+  else if((_command & 0xc0) == 0xc0) {                    // Only if the address command was received.
+    if(_address < MODEL_RAM51) {
+      ram[_address] = data;
+    }
+    if(autoMode) {
+      _address++;
+    }
+  }
+}
+
+// EOF
@@ -0,0 +1,59 @@
+/*!
+ * A pin level model of a TM1651, for testing the easiTM1651 library on a host.
+ *
+ * The model decodes the two wire protocol as the chip does - a start signal is the data falling while the clock is
+ * HIGH, a stop signal is the data rising while the clock is HIGH, the bits are read on the rising clock edges, LSB
+ * first, and the ACK is driven LOW from the 8th falling clock edge to the 9th. The commands set the address mode,
+ * the display control and the address, and the data bytes are written into the display RAM.
+ *
+ * ****************************
+ * *  TM1651 Model Header     *
+ * ****************************
+*/
+
+#ifndef __TM1651MODEL_H
+  #define __TM1651MODEL_H
+  #include <Arduino.h>
+  #include <string>
+  #include <vector>
+
+  #define MODEL_RAM51     4                               // The TM1651 display RAM, addresses 0xc0 - 0xc3.
+
+  class TM1651Model : public HostDevice {
+    public:
+      // TM1651Model Class instantiation - with the clock and data pins it is wired to.
+      TM1651Model(uint8_t, uint8_t);
+      uint8_t ram[MODEL_RAM51];                           // The display RAM.
+      uint8_t control;                                    // The last display control command, 0 until one is sent.
+      bool autoMode;                                      // Flag if the address auto increments.
+      uint32_t frames;                                    // The number of frames received, start signal to stop signal.
+      uint32_t bytes;                                     // The number of bytes received.
+      uint32_t nacks;                                     // The number of bytes that were not acknowledged.
+      uint32_t nackBytes;                                 // Do not acknowledge this many of the next bytes.
+      bool nackAll;                                       // Do not acknowledge anything, e.g. a loose data wire.
+      uint32_t ackDelay;                                  // The time in us after the 8th falling clock edge before the ACK is driven.
+      bool logEdges;                                      // Flag if the pin changes are added to the edge log.
+      std::string edges;                                  // The edge log - C/c is the clock rising/falling, D/d is the data rising/falling.
+      std::vector<std::vector<uint8_t>> frameLog;         // The bytes of every frame received.
+      void clearLogs(void);                               // Clear the counters and the logs, but not the display RAM.
+      std::string frameText(void);                        // Get the frame log as text, e.g. "[40] [c0 06 5b 4f]".
+      void pinsChanged(void);                             // Look at the pin levels.
+      bool pullsLow(uint8_t);                             // Check if the model is pulling a pin LOW, for the ACK.
+    private:
+      uint8_t _clkPin;                                    // The clock pin.
+      uint8_t _dioPin;                                    // The data pin.
+      uint8_t _clk;                                       // The last clock level seen.
+      uint8_t _dio;                                       // The last data level seen.
+      bool _inFrame;                                      // Flag if a start signal has been seen, and no stop signal yet.
+      uint8_t _bit;                                       // The number of bits of the current byte read, 9 during the ACK.
+      uint8_t _byte;                                      // The current byte.
+      uint8_t _address;                                   // The display RAM address for the next data byte.
+      uint8_t _command;                                   // The command that started the current frame, 0 if it was not received.
+      bool _acking;                                       // Flag if this byte is being acknowledged.
+      uint32_t _ackTime;                                  // The time of the 8th falling clock edge.
+      std::vector<uint8_t> _frame;                        // The bytes of the current frame.
+      void gotByte(uint8_t);                              // Carry out a received byte.
+  };
+#endif
+
+// EOF